@@ -1,11 +1,15 @@
 #include "AuthManager.hpp"
+#include <algorithm>
+#include <charconv>
 #include <iomanip>
 #include <iostream>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
-#include <ranges>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include "Database_Layer/Database.hpp"
 #include "Session_Manager/SessionManager.hpp"
@@ -16,46 +20,85 @@ struct OpenSSLFree {
     }
 };
 
+namespace {
+    constexpr std::string_view KDF_PREFIX = "pbkdf2-sha256$";
+    // what an unknown name waits until a real check has been timed
+    constexpr std::chrono::microseconds DEFAULT_MISS_DELAY{200000};
+
+    // PBKDF2 is only busy during logins, so a few threads are enough; unlike the code workers
+    // there is no inline fallback, a single core still gets one thread so the loop never hashes
+    size_t hashThreads() {
+        constexpr size_t MAX_HASH_THREADS = 4;
+        const size_t cores = std::thread::hardware_concurrency();
+        return cores > 2 ? std::min(cores - 2, MAX_HASH_THREADS) : 1;
+    }
+
+    std::string toHex(const unsigned char *data, const size_t size) {
+        constexpr char hex[] = "0123456789abcdef";
+        std::string digest;
+        digest.reserve(size * 2);
+        for (size_t i = 0; i < size; i++) {
+            digest += hex[data[i] >> 4];
+            digest += hex[data[i] & 0xf];
+        }
+        return digest;
+    }
+
+    bool equalHashes(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && CRYPTO_memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+}
+
 AuthManager::AuthManager(const std::string &server_type):
-    m_server_type(server_type) {
+    m_server_type(server_type), m_hash_pool(hashThreads()) {
     Database::init(server_type);
 }
 
-std::string AuthManager::m_hashPassword(const std::string& password, const std::string& salt) {
+std::string AuthManager::m_hashPassword(const std::string_view password, const std::string_view salt,
+                                        const uint32_t iterations) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    if (PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()),
+            reinterpret_cast<const unsigned char *>(salt.data()), static_cast<int>(salt.size()),
+            static_cast<int>(iterations), EVP_sha256(), sizeof(hash), hash) != 1) {
+        std::cerr << "[AM Error] Hashing error: PBKDF2 failed\n";
+        return {};
+    }
+    return std::string(KDF_PREFIX) + std::to_string(iterations) + '$' + toHex(hash, sizeof(hash));
+}
+
+std::string AuthManager::m_legacyHash(const std::string_view password, const std::string_view salt) {
     unsigned char hash[EVP_MAX_MD_SIZE];
     unsigned int hash_length = 0;
 
     std::unique_ptr<EVP_MD_CTX, OpenSSLFree> ctx(EVP_MD_CTX_new());
     if (ctx) {
-        try {
-            EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr);
-            EVP_DigestUpdate(ctx.get(), password.c_str(), password.size());
-            EVP_DigestUpdate(ctx.get(), salt.c_str(), salt.size());
-            EVP_DigestFinal_ex(ctx.get(), hash, &hash_length);
-        } catch (std::exception& e) {
-            std::cerr << "[AM Error] Hashing error: " << e.what() << "\n";
-        }
+        EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr);
+        EVP_DigestUpdate(ctx.get(), password.data(), password.size());
+        EVP_DigestUpdate(ctx.get(), salt.data(), salt.size());
+        EVP_DigestFinal_ex(ctx.get(), hash, &hash_length);
     }
+    return toHex(hash, hash_length);
+}
 
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (int i=0; i < hash_length; i++) {
-        ss << std::setw(2) << static_cast<int>(hash[i]);
+bool AuthManager::m_verifyPassword(const std::string_view password, const std::string_view salt,
+                                   const std::string_view stored, const uint32_t iterations, bool &stale) {
+    if (!stored.starts_with(KDF_PREFIX)) {
+        stale = true;
+        return equalHashes(m_legacyHash(password, salt), stored);
     }
-    return ss.str();
+    const std::string_view params = stored.substr(KDF_PREFIX.size());
+    uint32_t stored_iterations = 0;
+    const auto [end, error] = std::from_chars(params.data(), params.data() + params.size(), stored_iterations);
+    if (error != std::errc() || end == params.data() + params.size() || *end != '$' || stored_iterations == 0) {
+        std::cerr << "[AM Error] Malformed password hash\n";
+        return false;
+    }
+    stale = stored_iterations < iterations;
+    return equalHashes(m_hashPassword(password, salt, stored_iterations), stored);
 }
 
-std::string AuthManager::m_generateSecret() {
-    constexpr char base32[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
-    constexpr uint8_t length = 32;
-
-    std::vector<unsigned char> entropy(length);
-    RAND_bytes(entropy.data(), entropy.size());
-
-    std::string secret;
-    for (const unsigned char c : entropy)
-        secret += base32[c % length];
-    return secret;
+TOTPKey AuthManager::m_generateSecret(const TOTPParams &params) {
+    return TOTPKey::generate(params.algorithm == TOTPAlgorithm::SHA1 ? TOTPKey::SHA1_SIZE : TOTPKey::MAX_SIZE);
 }
 
 std::string AuthManager::m_generateSalt() {
@@ -87,6 +130,16 @@ std::string AuthManager::m_generateToken() {
     return token;
 }
 
+std::string AuthManager::generateResumeToken() {
+    unsigned char entropy[16];
+    RAND_bytes(entropy, sizeof(entropy));
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (const unsigned char c : entropy)
+        ss << std::setw(2) << static_cast<int>(c);
+    return ss.str();
+}
+
 std::string AuthManager::m_generateReqID() const {
     constexpr char dict[] = "ABCDEFGHIJKLMOPRQSTUVWXYZ0123456789";
     constexpr uint8_t entropy_len = 5;
@@ -102,93 +155,112 @@ std::string AuthManager::m_generateReqID() const {
 }
 
 // TODO username and password regex checking
-bool AuthManager::loginUser(const std::string& username, const std::string& password) {
+HashPool::Awaiter AuthManager::loginUser(const std::string& username, const std::string& password,
+                                         PasswordCheck &check, std::pmr::memory_resource *resource) {
+    const std::optional<Database::UserDTO> user = Database::getUser(username, resource);
+    // unknown and filtered names are refused after about as long as a real check takes, without
+    // hashing: they would otherwise fill the pool and turn real users away with 304s
+    if (!user.has_value()) return m_hash_pool.delay(m_missDelay());
 
-    if (const std::optional<Database::UserDTO> result = Database::getUser(username);
-        result.has_value()) {
-        if (m_hashPassword(password, result->salt) == result->pass_hash)
-            return true;
-    }
-    return false;
+    // the work outlives the command, so it gets its own copies instead of arena strings
+    return m_hash_pool.run([&check, &average = m_check_us, password, salt = std::string(user->salt),
+                            stored = std::string(user->pass_hash), iterations = m_kdf_iterations] {
+        const auto start = std::chrono::steady_clock::now();
+        bool stale = false;
+        check.valid = m_verifyPassword(password, salt, stored, iterations, stale);
+        const int64_t took = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        // an update lost to another thread only costs the average a sample
+        const int64_t old = average.load(std::memory_order_relaxed);
+        average.store(old == 0 ? took : old + (took - old) / 8, std::memory_order_relaxed);
+        if (check.valid && stale) check.rehash = m_hashPassword(password, salt, iterations);
+    });
 }
 
-bool AuthManager::registerUser(const std::string &username, const std::string &password) {
-    const std::string salt = m_generateSalt();
-    const std::string pass_hash = m_hashPassword(password, salt);
+std::chrono::microseconds AuthManager::m_missDelay() const {
+    const int64_t average = m_check_us.load(std::memory_order_relaxed);
+    const int64_t base = average > 0 ? average : DEFAULT_MISS_DELAY.count();
+    // 0.75 to 1.25 times the average, so misses spread over the range real checks land in
+    uint16_t jitter = 0;
+    if (RAND_bytes(reinterpret_cast<unsigned char *>(&jitter), sizeof(jitter)) != 1) jitter = 0x8000;
+    return std::chrono::microseconds(base * 3 / 4 + base * jitter / 2 / 0x10000);
+}
+
+HashPool::Awaiter AuthManager::hashPassword(const std::string &password, PasswordHash &hash) {
+    hash.salt = m_generateSalt();
+    return m_hash_pool.run([&hash, password, iterations = m_kdf_iterations] {
+        hash.hash = m_hashPassword(password, hash.salt, iterations);
+    });
+}
+
+void AuthManager::upgradePassword(const std::string &username, const PasswordCheck &check) {
+    if (check.rehash.empty()) return;
+    if (Database::updatePassword(username, check.rehash))
+        std::cout << "[AM Log] Rehashed password of " << username << " at " << m_kdf_iterations << " iterations\n";
+}
+
+bool AuthManager::registerUser(const std::string &username, const PasswordHash &hash) {
+    if (hash.hash.empty()) return false;
 #ifdef A_SERVER
-    const Database::UserDTO user{username, pass_hash, salt, m_generateSecret()};
+    const Database::UserDTO user{std::pmr::string(username), std::pmr::string(hash.hash), std::pmr::string(hash.salt),
+        std::pmr::string(m_generateSecret().toBase32())};
 #else
-    const Database::UserDTO user{username, pass_hash, salt};
+    const Database::UserDTO user{std::pmr::string(username), std::pmr::string(hash.hash), std::pmr::string(hash.salt)};
 #endif
     if (Database::createUser(user)) return true;
     return false;
 }
 
-std::string AuthManager::startPairing(const std::string &d_username, const std::string &app_id) {
-    for (auto &pair: m_pending_pairings | std::views::values) {
-        if (pair.d_username == d_username && pair.app_id == app_id)
-            return "";
-    }
+void AuthManager::update() {
+    m_hash_pool.update();
+}
 
-    const std::string secret = m_generateSecret();
-    const std::string token = m_generateToken();
+void AuthManager::setKdfIterations(const uint32_t iterations) {
+    m_kdf_iterations = std::max(iterations, MIN_KDF_ITERATIONS);
+    std::cout << "[AM Log] New password hashes use " << m_kdf_iterations << " PBKDF2 iterations\n";
+}
+
+std::optional<PendingPairing> AuthManager::startPairing(const std::string &d_username, const std::string &app_id,
+                                                        const TOTPParams &params) {
+    if (!m_pairings_in_flight.emplace(d_username, app_id).second)
+        return std::nullopt;
 
     PendingPairing pairing;
     pairing.d_username = d_username;
     pairing.app_id = app_id;
-    pairing.secret = secret;
+    pairing.secret = m_generateSecret(params);
+    pairing.params = params;
+    pairing.token = m_generateToken();
 
-    m_pending_pairings[token] = pairing;
-    std::cout << "[AM Log] Generated token " << token << " for " << d_username << "\n";
-    return token;
+    std::cout << "[AM Log] Generated token " << pairing.token << " for " << d_username << "\n";
+    return pairing;
 }
 
-std::optional<std::pair<std::string, std::string>> AuthManager::finishPairing(const std::string &a_username, const std::string &token) {
-    auto it = m_pending_pairings.find(token);
-    if (it == m_pending_pairings.end()) {
-        std::cerr << "[AM Error] Invalid pairing token: " << token << "!\n";
-        return std::nullopt;
-    }
-    if (Database::pairUser(a_username, it->second.d_username, it->second.app_id, it->second.secret)) {
-        auto pair = std::make_pair(it->second.app_id, it->second.secret);
-        m_pending_pairings.erase(it);
-        return pair;
-    }
-    return std::nullopt;
+bool AuthManager::finishPairing(const std::string &a_username, const PendingPairing &pairing) {
+    cancelPairing(pairing);
+    return Database::pairUser(a_username, pairing.d_username, pairing.app_id, {pairing.secret, pairing.params});
 }
 
-int AuthManager::startNotification(const std::string &username, const std::string &app_id, std::string &reqID, const int &ds_fd, SessionManager &session_manager) {
+void AuthManager::cancelPairing(const PendingPairing &pairing) {
+    m_pairings_in_flight.erase({pairing.d_username, pairing.app_id});
+}
+
+std::vector<int> AuthManager::startNotification(const std::string &username, const std::string &app_id,
+                                                std::string &reqID, SessionManager &session_manager) {
     const auto a_user_resp = Database::getA_username(username, app_id);
     if (!a_user_resp.has_value()) {
         std::cerr << "[AM Error] User not found!\n";
-        return -1;
+        return {};
     }
-    const int ac_fd = session_manager.getIDFromUsername(a_user_resp.value());
-    if (ac_fd <= 0) {
+    std::vector<int> ac_fds = session_manager.getIDsFromUsername(a_user_resp.value());
+    if (ac_fds.empty()) {
         std::cerr << "[AM Error] User not logged in!\n";
-        return -1;
+        return {};
     }
 
-    PendingNotification notification;
-    notification.ds_fd = ds_fd;
-    notification.app_id = app_id;
-    notification.d_username = username;
     reqID = m_generateReqID();
-    m_pending_notifications[reqID] = notification;
-
     std::cout << "[AM Log] Notification " << reqID << " created for " << a_user_resp.value() << "\n";
-    return ac_fd;
-}
-
-int AuthManager::finishNotification(const std::string &reqID, std::string &d_username) {
-    if (const auto it = m_pending_notifications.find(reqID); it != m_pending_notifications.end()) {
-        const int ds_fd = it->second.ds_fd;
-        d_username = it->second.d_username;
-        m_pending_notifications.erase(it);
-        return ds_fd;
-    }
-    std::cerr << "[AM Error] Invalid notification ID: " << reqID << "!\n";
-    return -1;
+    return ac_fds;
 }
 
 void AuthManager::show() {
@@ -1,50 +1,101 @@
 #ifndef MY2FA_LOGGER_HPP
 #define MY2FA_LOGGER_HPP
 
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
 #include <optional>
+#include <set>
 #include <string>
+#include <vector>
+#include "HashPool.hpp"
 #include "Session_Manager/SessionManager.hpp"
 
 struct PendingPairing {
     std::string d_username;
     std::string app_id;
-    std::string secret;
+    TOTPKey secret;
+    TOTPParams params;
+    std::string token;
 };
 
-struct PendingNotification {
-    std::string d_username;
-    std::string app_id;
-    int ds_fd;
+// outcome of a password check, filled in on a hash pool thread
+struct PasswordCheck {
+    bool valid = false;
+    // the stored hash re-derived at the current cost, set when a valid one was legacy or cheaper
+    std::string rehash;
+};
+
+// salt and encoded hash of a new account
+struct PasswordHash {
+    std::string salt;
+    std::string hash;
 };
 
 class AuthManager {
 public:
+    // PBKDF2-HMAC-SHA256 rounds for new hashes, every stored hash carries its own count
+    static constexpr uint32_t DEFAULT_KDF_ITERATIONS = 600000;
+    static constexpr uint32_t MIN_KDF_ITERATIONS = 10000;
+
     explicit AuthManager(const std::string &server_type);
 
-    [[nodiscard]] bool loginUser(const std::string &username, const std::string &password);
-    [[nodiscard]] bool registerUser(const std::string &username, const std::string &password);
+    // both co_awaited from a flow: the KDF runs on the hash pool and the flow resumes on the
+    // event loop, they yield false if the pool queue was full and nothing was checked
+    [[nodiscard]] HashPool::Awaiter loginUser(const std::string &username, const std::string &password,
+        PasswordCheck &check, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    [[nodiscard]] HashPool::Awaiter hashPassword(const std::string &password, PasswordHash &hash);
+    // stores check.rehash if the login produced one
+    void upgradePassword(const std::string &username, const PasswordCheck &check);
+    [[nodiscard]] bool registerUser(const std::string &username, const PasswordHash &hash);
+    // resumes the flows whose hashing finished, called from the server loop
+    void update();
+    void setKdfIterations(uint32_t iterations);
+    [[nodiscard]] uint32_t getKdfIterations() const { return m_kdf_iterations; }
+    [[nodiscard]] HashPool::Stats getHashStats() const { return m_hash_pool.stats(); }
+    // one-shot token an AuthClient can use to reattach after its connection drops
+    [[nodiscard]] static std::string generateResumeToken();
 
-    [[nodiscard]] std::string startPairing(const std::string &d_username, const std::string &app_id);
-    [[nodiscard]] std::optional<std::pair<std::string, std::string>> finishPairing(
-        const std::string &a_username, const std::string &token);
+    // the pending state itself lives in the pairing / notification flows
+    [[nodiscard]] std::optional<PendingPairing> startPairing(const std::string &d_username, const std::string &app_id,
+        const TOTPParams &params = DEFAULT_TOTP_PARAMS);
+    [[nodiscard]] bool finishPairing(const std::string &a_username, const PendingPairing &pairing);
+    void cancelPairing(const PendingPairing &pairing);
 
-    [[nodiscard]] int startNotification(const std::string &username, const std::string &app_id, std::string &reqID,
-                          const int &ds_fd, SessionManager &session_manager);
-    [[nodiscard]] int finishNotification(const std::string &reqID, std::string &d_username);
+    // returns every AuthClient session of the paired user, empty if none is logged in
+    [[nodiscard]] std::vector<int> startNotification(const std::string &username, const std::string &app_id,
+                          std::string &reqID, SessionManager &session_manager);
 
 
     void show();
 private:
     const std::string m_server_type;
-    std::map<std::string, PendingPairing> m_pending_pairings;
-    std::map<std::string, PendingNotification> m_pending_notifications;
+    // (d_username, app_id); kept as text since the names are unconfirmed DS input that must
+    // not grow the interner, they are only interned once the pairing is stored
+    std::set<std::pair<std::string, std::string>> m_pairings_in_flight;
+    uint32_t m_kdf_iterations = DEFAULT_KDF_ITERATIONS;
+    // running average of a real password check in microseconds, written by the hash pool
+    // threads, so it is declared before the pool that joins them
+    std::atomic<int64_t> m_check_us{0};
+    HashPool m_hash_pool;
 
-    [[nodiscard]] std::string m_hashPassword(const std::string& password, const std::string& salt) ;
+    // the helpers below run on hash pool threads and only touch their arguments
+    // "pbkdf2-sha256$<iterations>$<hex>"
+    [[nodiscard]] static std::string m_hashPassword(std::string_view password, std::string_view salt,
+        uint32_t iterations);
+    // hashes from before the KDF: hex SHA-256 over password then salt
+    [[nodiscard]] static std::string m_legacyHash(std::string_view password, std::string_view salt);
+    // checks password against an encoded or legacy hash, stale is set when it should be rehashed
+    [[nodiscard]] static bool m_verifyPassword(std::string_view password, std::string_view salt,
+        std::string_view stored, uint32_t iterations, bool &stale);
     [[nodiscard]] std::string m_generateSalt();
-    [[nodiscard]] std::string m_generateSecret();
+    // sized for the pairing's HMAC: 20 bytes for SHA-1, the 32 byte maximum for SHA-2
+    [[nodiscard]] static TOTPKey m_generateSecret(const TOTPParams &params = DEFAULT_TOTP_PARAMS);
     [[nodiscard]] std::string m_generateToken();
     [[nodiscard]] std::string m_generateReqID() const;
+    // how long a login with an unknown name waits before it is refused
+    [[nodiscard]] std::chrono::microseconds m_missDelay() const;
 };
 
 #endif //MY2FA_LOGGER_HPP
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "HashPool.hpp"
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+HashPool::Awaiter::Awaiter(HashPool &pool, std::function<void()> work, const std::chrono::microseconds wait)
+    : m_pool(pool), m_work(std::move(work)), m_wait(wait) {}
+
+bool HashPool::Awaiter::await_suspend(const std::coroutine_handle<> handle) {
+    if (!m_work) {
+        m_pool.m_delayed.emplace(std::chrono::steady_clock::now() + m_wait, handle);
+        return true;
+    }
+    m_accepted = m_pool.m_submit({std::move(m_work), handle});
+    return m_accepted; // a rejected job resumes the flow on the spot
+}
+
+HashPool::HashPool(const size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        m_threads.emplace_back([this](std::stop_token stop_token) { m_run(stop_token); });
+}
+
+HashPool::~HashPool() {
+    for (std::jthread &thread : m_threads) thread.request_stop();
+    m_threads.clear();
+    // flows still waiting at shutdown never get their result, free their frames
+    for (const Job &job : m_queue) job.handle.destroy();
+    for (const std::coroutine_handle<> handle : m_done) handle.destroy();
+    for (const std::coroutine_handle<> handle : m_delayed | std::views::values) handle.destroy();
+}
+
+HashPool::Awaiter HashPool::run(std::function<void()> work) {
+    return {*this, std::move(work)};
+}
+
+HashPool::Awaiter HashPool::delay(const std::chrono::microseconds wait) {
+    return {*this, nullptr, wait};
+}
+
+bool HashPool::m_submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_in_flight >= MAX_QUEUED) {
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_in_flight++;
+        m_queue.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+void HashPool::m_run(std::stop_token stop_token) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_wake.wait(lock, stop_token, [this] { return !m_queue.empty(); })) return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        job.work();
+        // the mutex also publishes what the work wrote to the flow's frame
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done.push_back(job.handle);
+    }
+}
+
+size_t HashPool::update() {
+    size_t resumed = 0;
+    // a resumed flow may delay again, it is due later so the loop won't pick it up twice
+    const auto now = std::chrono::steady_clock::now();
+    while (!m_delayed.empty() && m_delayed.begin()->first <= now) {
+        const std::coroutine_handle<> handle = m_delayed.begin()->second;
+        m_delayed.erase(m_delayed.begin());
+        handle.resume();
+        resumed++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_done.empty()) return resumed;
+        m_resuming.swap(m_done);
+        m_in_flight -= m_resuming.size();
+    }
+    m_completed.fetch_add(m_resuming.size(), std::memory_order_relaxed);
+    resumed += m_resuming.size();
+    for (const std::coroutine_handle<> handle : m_resuming) handle.resume();
+    m_resuming.clear();
+    return resumed;
+}
+
+HashPool::Stats HashPool::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_threads.size(), m_in_flight, m_completed.load(std::memory_order_relaxed),
+        m_rejected.load(std::memory_order_relaxed)};
+}
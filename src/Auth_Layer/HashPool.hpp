@@ -0,0 +1,86 @@
+#ifndef MY2FA_HASHPOOL_HPP
+#define MY2FA_HASHPOOL_HPP
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for the password KDF, so a login never hashes on the event loop.
+// A flow co_awaits run(work): the work runs on a worker and the flow is resumed from
+// update() on the event loop thread, the only one allowed to touch sessions and the database.
+// The queue is capped, a full one turns the co_await into an immediate false.
+// delay(wait) parks a flow for a while instead, it takes neither a worker nor a queue slot.
+class HashPool {
+public:
+    static constexpr size_t MAX_QUEUED = 64;
+
+    class Awaiter {
+    public:
+        Awaiter(HashPool &pool, std::function<void()> work, std::chrono::microseconds wait = {});
+
+        // run(nullptr) has nothing to offload and resumes right away
+        [[nodiscard]] bool await_ready() const noexcept { return !m_work && m_wait.count() <= 0; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        // false if the queue was full and the work never ran
+        [[nodiscard]] bool await_resume() const noexcept { return m_accepted; }
+
+    private:
+        HashPool &m_pool;
+        std::function<void()> m_work;
+        std::chrono::microseconds m_wait;
+        bool m_accepted = true;
+    };
+
+    struct Stats {
+        size_t threads;
+        size_t queued; // waiting for or running on a worker
+        uint64_t completed;
+        uint64_t rejected;
+    };
+
+    explicit HashPool(size_t threads);
+    ~HashPool();
+    HashPool(const HashPool &) = delete;
+    HashPool &operator=(const HashPool &) = delete;
+
+    // the work must not touch anything but its own captures
+    [[nodiscard]] Awaiter run(std::function<void()> work);
+    // resumes after wait with true, from update() like the rest
+    [[nodiscard]] Awaiter delay(std::chrono::microseconds wait);
+    // resumes the flows whose work is done or whose delay ran out, called from the event loop;
+    // returns how many
+    size_t update();
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Job {
+        std::function<void()> work;
+        std::coroutine_handle<> handle;
+    };
+
+    std::deque<Job> m_queue;
+    size_t m_in_flight = 0; // queued plus running, what MAX_QUEUED caps
+    std::vector<std::coroutine_handle<>> m_done;
+    std::vector<std::coroutine_handle<>> m_resuming; // swapped with m_done by update()
+    // delayed flows by due time, only touched from the event loop so outside the mutex
+    std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<>> m_delayed;
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_rejected{0};
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::vector<std::jthread> m_threads; // last, so they stop before the rest goes away
+
+    bool m_submit(Job job);
+    void m_run(std::stop_token stop_token);
+};
+
+#endif //MY2FA_HASHPOOL_HPP
@@ -19,6 +19,7 @@ enum class CommandType : uint8_t {
     LOGIN_REQ = 12,
     LOGOUT_REQ = 13,
     REGISTER_REQ = 14,
+    RESUME_REQ = 15,
 
     // Notification Login Commands
     REQ_NOTIF = 21,
@@ -31,6 +32,7 @@ enum class CommandType : uint8_t {
     VALIDATE_CODE_SERVER = 34,
     VALIDATE_RESP_SERVER = 35,
     VALIDATE_RESP_CLIENT = 36,
+    SUBSCRIBE_CODES = 39,
 
     // Response Types
     LOGIN_RESP = 41,
@@ -56,6 +58,7 @@ inline std::ostream& operator<<(std::ostream& os, const CommandType& type) {
         case CommandType::LOGIN_RESP: return os << "LOGIN_RESP";
         case CommandType::LOGOUT_REQ: return os << "LOGOUT_REQ";
         case CommandType::REGISTER_REQ: return os << "REGISTER_REQ";
+        case CommandType::RESUME_REQ: return os << "RESUME_REQ";
         case CommandType::REGISTER_RESP: return os << "REGISTER_RESP";
         case CommandType::SEND_NOTIF: return os << "SEND_NOTIF";
         case CommandType::REQ_CODE_CLIENT: return os << "REQ_CODE_CLIENT";
@@ -63,6 +66,7 @@ inline std::ostream& operator<<(std::ostream& os, const CommandType& type) {
         case CommandType::VALIDATE_CODE_CLIENT: return os << "VALIDATE_CODE_CLIENT";
         case CommandType::VALIDATE_CODE_SERVER: return os << "VALIDATE_CODE_SERVER";
         case CommandType::VALIDATE_RESP_SERVER: return os << "VALIDATE_RESP_SERVER";
+        case CommandType::SUBSCRIBE_CODES: return os << "SUBSCRIBE_CODES";
         case CommandType::EXIT_SCS: return os << "EXIT_SCS";
         default: return os << "UNKNOWN";
     }
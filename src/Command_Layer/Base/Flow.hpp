@@ -0,0 +1,68 @@
+#ifndef MY2FA_FLOW_HPP
+#define MY2FA_FLOW_HPP
+
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <new>
+
+// Free list of fixed size blocks for coroutine frames.
+// Flows are only started and resumed from the event loop thread, so no locking is needed.
+class FramePool {
+public:
+    static constexpr size_t BLOCK_SIZE = 1024;
+
+    static void *allocate(const size_t size) {
+        if (size > BLOCK_SIZE) return ::operator new(size);
+        if (m_free) {
+            Block *block = m_free;
+            m_free = block->next;
+            return block;
+        }
+        return ::operator new(BLOCK_SIZE);
+    }
+
+    static void deallocate(void *ptr, const size_t size) {
+        if (size > BLOCK_SIZE) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto *block = static_cast<Block *>(ptr);
+        block->next = m_free;
+        m_free = block;
+    }
+
+private:
+    struct Block {
+        Block *next;
+    };
+    static inline Block *m_free = nullptr;
+};
+
+// Fire and forget coroutine for commands that span several hops.
+// It runs eagerly until the first co_await and the frame frees itself when the flow ends.
+struct Flow {
+    struct promise_type {
+        Flow get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+
+        void unhandled_exception() {
+            try {
+                std::rethrow_exception(std::current_exception());
+            } catch (const std::exception &e) {
+                std::cerr << "[Flow Error] Flow execution failed: " << e.what() << "\n";
+            } catch (...) {
+                std::cerr << "[Flow Error] Flow execution failed!\n";
+            }
+        }
+
+        static void *operator new(const size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void *ptr, const size_t size) { FramePool::deallocate(ptr, size); }
+    };
+};
+
+#endif //MY2FA_FLOW_HPP
@@ -6,6 +6,7 @@
 #include "ValidateCodeClientCommand.hpp"
 #include "ValidateCodeServerCommand.hpp"
 #include "ValidateResponseServerCommand.hpp"
+#include "SubscribeCodesCommand.hpp"
 
 // I am aware this increases compile time, but for a project this small it's fine
 
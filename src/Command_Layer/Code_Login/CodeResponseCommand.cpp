@@ -5,29 +5,56 @@
 #ifdef A_CLIENT
 #include <ctime>
 #include "Command_Layer/Context.hpp"
+#include "TOTP_Layer/TOTPGenerator.hpp"
 #endif
-CodeResponseCommand::CodeResponseCommand (const uint32_t remaining_time, std::string payload)
-    : m_remaining_time(remaining_time), m_payload(std::move(payload)) {}
+CodeResponseCommand::CodeResponseCommand (const uint32_t remaining_time, const uint64_t step, std::string payload)
+    : m_remaining_time(remaining_time), m_step(step), m_payload(std::move(payload)) {}
 
 std::string CodeResponseCommand::serialize() const {
     std::stringstream ss;
-    ss << static_cast<int>(CommandType::CODE_RESP) << DELIMITER << m_remaining_time << DELIMITER << m_payload;
+    ss << static_cast<int>(CommandType::CODE_RESP) << DELIMITER << m_remaining_time
+            << DELIMITER << m_step << DELIMITER << m_payload;
     return ss.str();
 }
 
 void CodeResponseCommand::execute(Context &ctx, int client_fd) {
 #ifdef A_CLIENT
-    ctx.timeExpiration = std::time(nullptr) + m_remaining_time;
-    ctx.codes.clear();
+    if (m_step < ctx.codesStep) return; // a late frame of a window already shown
+
+    std::map<std::string, std::string> codes;
     std::stringstream ss(m_payload);
     std::string pair;
     while (std::getline(ss, pair, '|')) {
         const uint32_t separator = pair.find(':');
-        ctx.codes[pair.substr(0, separator)] = pair.substr(separator + 1);
+        codes[pair.substr(0, separator)] = pair.substr(separator + 1);
+    }
+
+    const time_t now = std::time(nullptr);
+    const time_t expiration = now + m_remaining_time;
+    // pushed ahead of its step, shown once the step starts
+    if (now < TOTPGenerator::stepStart(m_step)) {
+        ctx.nextCodes = std::move(codes);
+        ctx.nextCodesStep = m_step;
+        ctx.nextExpiration = expiration;
+        return;
     }
+    ctx.codes = std::move(codes);
+    ctx.codesStep = m_step;
+    ctx.timeExpiration = expiration;
 #endif
 };
 
+#ifdef A_CLIENT
+void CodeResponseCommand::promoteNextCodes(Context &ctx) {
+    if (ctx.nextCodes.empty() || ctx.nextCodesStep <= ctx.codesStep) return;
+    if (std::time(nullptr) < TOTPGenerator::stepStart(ctx.nextCodesStep)) return;
+    ctx.codes = std::move(ctx.nextCodes);
+    ctx.nextCodes.clear();
+    ctx.codesStep = ctx.nextCodesStep;
+    ctx.timeExpiration = ctx.nextExpiration;
+}
+#endif
+
 CommandType CodeResponseCommand::getType() const {
     return CommandType::CODE_RESP;
 }
\ No newline at end of file
@@ -5,17 +5,26 @@
 #include <map>
 #include "Command_Layer/Base/Command.hpp"
 
+// step counts the server's push cadence (the default period) and tags the window the frame
+// starts in; remaining_time counts down to the first boundary of the frame's own periods,
+// so a frame of 60 second pairings or one pushed ahead of its step holds more than 30 seconds
 class CodeResponseCommand : public Command {
 public:
-    CodeResponseCommand(uint32_t remaining_time, std::string payload);
+    CodeResponseCommand(uint32_t remaining_time, uint64_t step, std::string payload);
 
     [[nodiscard]] std::string serialize() const override;
     void execute(Context &ctx, int client_fd) override;
 
     [[nodiscard]] CommandType getType() const override;
 
+#ifdef A_CLIENT
+    // swaps in codes received ahead of time once their window has started
+    static void promoteNextCodes(Context &ctx);
+#endif
+
 private:
     const uint32_t m_remaining_time;
+    const uint64_t m_step;
     const std::string m_payload;
 };
 
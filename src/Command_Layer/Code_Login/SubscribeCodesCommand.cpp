@@ -0,0 +1,44 @@
+#include "SubscribeCodesCommand.hpp"
+#include <sstream>
+#include <utility>
+#ifdef A_SERVER
+#include "Command_Layer/Context.hpp"
+#include "Session_Manager/SessionManager.hpp"
+#include "TOTP_Layer/TOTPManager.hpp"
+#endif
+
+SubscribeCodesCommand::SubscribeCodesCommand(std::vector<std::string> app_ids) : m_app_ids(std::move(app_ids)) {}
+
+SubscribeCodesCommand SubscribeCodesCommand::parse(const std::string &app_ids) {
+    std::vector<std::string> apps;
+    std::stringstream ss(app_ids);
+    std::string app_id;
+    while (std::getline(ss, app_id, '|') && apps.size() < MAX_APPS)
+        if (!app_id.empty()) apps.push_back(app_id);
+    return SubscribeCodesCommand(std::move(apps));
+}
+
+std::string SubscribeCodesCommand::serialize() const {
+    std::stringstream ss;
+    ss << static_cast<int>(CommandType::SUBSCRIBE_CODES);
+    for (size_t i = 0; i < m_app_ids.size(); ++i)
+        ss << (i == 0 ? DELIMITER : '|') << m_app_ids[i];
+    return ss.str();
+}
+
+void SubscribeCodesCommand::execute(Context &ctx, const int client_fd) {
+#ifdef A_SERVER
+    if (!ctx.session_manager.getIsLogged(client_fd)) {
+        std::cerr << "[AS Error] Session " << client_fd << " set a code filter without being logged in!\n";
+        return;
+    }
+    const size_t shown = ctx.session_manager.setCodeFilter(client_fd, m_app_ids);
+    // an open code view gets the narrowed frame right away instead of at the next window
+    if (shown > 0 && ctx.session_manager.getIsInCodeState(client_fd))
+        ctx.totp_manager->sendCodesToClient(ctx.session_manager.getSession(client_fd));
+#endif
+}
+
+CommandType SubscribeCodesCommand::getType() const {
+    return CommandType::SUBSCRIBE_CODES;
+}
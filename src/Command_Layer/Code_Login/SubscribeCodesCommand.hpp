@@ -0,0 +1,28 @@
+#ifndef MY2FA_SUBSCRIBECODESCOMMAND_HPP
+#define MY2FA_SUBSCRIBECODESCOMMAND_HPP
+
+#include <string>
+#include <vector>
+#include "Command_Layer/Base/Command.hpp"
+
+// limits the AuthClient's pushed codes to some of its apps, app_ids separated by '|';
+// without any app_id every pairing is pushed again
+class SubscribeCodesCommand : public Command {
+public:
+    explicit SubscribeCodesCommand(std::vector<std::string> app_ids = {});
+
+    // the '|' separated form the command travels in
+    [[nodiscard]] static SubscribeCodesCommand parse(const std::string &app_ids);
+
+    [[nodiscard]] std::string serialize() const override;
+    void execute(Context &ctx, int client_fd) override;
+
+    [[nodiscard]] CommandType getType() const override;
+
+private:
+    static constexpr size_t MAX_APPS = 64;
+
+    const std::vector<std::string> m_app_ids;
+};
+
+#endif //MY2FA_SUBSCRIBECODESCOMMAND_HPP
@@ -10,7 +10,7 @@
 #include "Command_Layer/Context.hpp"
 #include "Connection_Layer/ServerConnectionHandler.hpp"
 #include "Session_Manager/SessionManager.hpp"
-#include "Auth_Layer/AuthManager.hpp"
+#include "Command_Layer/FlowManager.hpp"
 #elif defined(D_SERVER)
 #include "Command_Layer/Context.hpp"
 #include "Connection_Layer/ClientConnectionHandler.hpp"
@@ -33,13 +33,9 @@ public:
     void execute(Context &ctx, const int client_fd) override {
 #ifdef A_SERVER
         if (m_code.length() != 6) {
-            const auto result = ctx.auth_manager->finishPairing(
-            ctx.session_manager.getIdentity(client_fd), m_code);
-            if (result.has_value()) {
-                ctx.session_manager.getSession(client_fd)->ac_data->secret_pairs[result->first] = result->second;
-            } else {
+            // hands the token to the pairing flow waiting on it
+            if (!ctx.flow_manager->resume(FlowKind::PAIRING, m_code, {client_fd, true, ctx.session_manager.getIdentity(client_fd)}))
                 std::cerr << "[2FA Pairing Error] Invalid token!\n";
-            }
         }
 #elif defined(D_SERVER)
         std::cout << "[2FA Check] Sending code to AS :" << m_code << "\n";
@@ -0,0 +1,52 @@
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "Command_Layer/FlowManager.hpp"
+#include "Connection_Layer/ServerConnectionHandler.hpp"
+#include "Session_Manager/SessionManager.hpp"
+#include "ValidateCodeClientCommand.hpp"
+#include "Test_Layer/TestCheck.hpp"
+
+// A VALIDATE_CODE_CLIENT whose code isn't 6 digits is a pairing token. It must only reach a
+// pairing flow, never a notification flow, even when a client sends a reqID in its place.
+namespace {
+    using TestCheck::expect;
+
+    // shaped like AuthManager's: 8 base32 characters for a pairing, 5 for a notification
+    constexpr std::string_view PAIRING_TOKEN = "K7P2QX9M";
+    constexpr std::string_view REQ_ID = "Q7K2M";
+
+    Flow waitFor(FlowManager &flows, const FlowKind kind, const std::string &key, std::optional<FlowReply> &out) {
+        out = co_await flows.awaitReply(kind, key, std::chrono::seconds(60));
+    }
+}
+
+int main() {
+    SessionManager session_manager;
+    ServerConnectionHandler handler(0);
+    FlowManager flow_manager;
+    Context ctx{session_manager, nullptr, handler, nullptr, &flow_manager};
+
+    std::optional<FlowReply> notification;
+    std::optional<FlowReply> pairing;
+    waitFor(flow_manager, FlowKind::NOTIFICATION, std::string(REQ_ID), notification);
+    waitFor(flow_manager, FlowKind::PAIRING, std::string(PAIRING_TOKEN), pairing);
+    expect(flow_manager.pendingCount() == 2, "flows not waiting");
+
+    ValidateCodeClientCommand(std::string(REQ_ID)).execute(ctx, 7);
+    expect(!notification, "reqID sent as a pairing token resumed a notification flow");
+    expect(!pairing, "reqID resumed a pairing flow");
+    expect(flow_manager.pendingCount() == 2, "a flow stopped waiting");
+
+    ValidateCodeClientCommand(std::string(PAIRING_TOKEN)).execute(ctx, 7);
+    expect(pairing && pairing->fd == 7 && pairing->accepted, "pairing flow not resumed by its token");
+    expect(!notification, "notification flow resumed along with the pairing one");
+    expect(flow_manager.pendingCount() == 1, "pairing flow still waiting");
+
+    expect(flow_manager.resume(FlowKind::NOTIFICATION, std::string(REQ_ID), {8, false, ""}), "notification reply lost");
+    expect(notification && notification->fd == 8 && !notification->accepted, "notification flow got the wrong reply");
+    expect(flow_manager.pendingCount() == 0, "flows left waiting");
+
+    return TestCheck::result("ValidateCodeClient");
+}
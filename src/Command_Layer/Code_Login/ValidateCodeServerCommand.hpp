@@ -6,7 +6,7 @@
 #include "Command_Layer/Base/Command.hpp"
 #ifdef A_SERVER
 #include "Command_Layer/Context.hpp"
-#include "TOTP_Layer/TOTPGenerator.hpp"
+#include "TOTP_Layer/TOTPManager.hpp"
 #include "Session_Manager/SessionManager.hpp"
 #include "Database_Layer/Database.hpp"
 #include "Connection_Layer/ServerConnectionHandler.hpp"
@@ -32,7 +32,7 @@ public:
     #ifdef A_SERVER
         bool resp;
         auto result = Database::getSecret(m_username, m_app_id);
-        if (result.has_value() && TOTPGenerator::verifyCode(result.value(), m_code)) {
+        if (result.has_value() && ctx.totp_manager->consumeCode(m_username, m_app_id, result.value(), m_code)) {
             resp = true;
         } else resp = false;
 
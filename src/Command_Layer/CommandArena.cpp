@@ -0,0 +1,41 @@
+#include "CommandArena.hpp"
+
+CommandArena::CommandArena()
+    : m_monotonic(m_buffer, BUFFER_SIZE, &m_heap) {}
+
+void CommandArena::reset() {
+    m_monotonic.release(); // gives back any heap chunks and rewinds to the inline buffer
+    m_stats.dispatches++;
+}
+
+CommandArena::Stats CommandArena::getStats() const {
+    Stats stats = m_stats;
+    stats.heap_bytes = m_heap.bytes;
+    return stats;
+}
+
+void *CommandArena::do_allocate(const size_t bytes, const size_t alignment) {
+    m_stats.arena_bytes += bytes;
+    return m_monotonic.allocate(bytes, alignment);
+}
+
+void CommandArena::do_deallocate(void *ptr, const size_t bytes, const size_t alignment) {
+    m_monotonic.deallocate(ptr, bytes, alignment); // no-op, freed on reset
+}
+
+bool CommandArena::do_is_equal(const memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+void *CommandArena::HeapCounter::do_allocate(const size_t bytes, const size_t alignment) {
+    this->bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void CommandArena::HeapCounter::do_deallocate(void *ptr, const size_t bytes, const size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+bool CommandArena::HeapCounter::do_is_equal(const memory_resource &other) const noexcept {
+    return this == &other;
+}
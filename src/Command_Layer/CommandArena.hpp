@@ -0,0 +1,51 @@
+#ifndef MY2FA_COMMANDARENA_HPP
+#define MY2FA_COMMANDARENA_HPP
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Monotonic arena for the temporaries of a single command dispatch (parsing, DTOs, digests).
+// The server connection handler resets it after every command, so nothing allocated from it
+// may outlive the dispatch. Only used from the event loop thread.
+class CommandArena final : public std::pmr::memory_resource {
+public:
+    static constexpr size_t BUFFER_SIZE = 16 * 1024;
+
+    struct Stats {
+        uint64_t dispatches;
+        uint64_t arena_bytes; // bytes handed out by the arena
+        uint64_t heap_bytes;  // bytes the arena had to take from the global heap
+    };
+
+    CommandArena();
+
+    CommandArena(const CommandArena &) = delete;
+    CommandArena &operator=(const CommandArena &) = delete;
+
+    void reset();
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    // forwards to the global heap and counts what falls through the inline buffer
+    class HeapCounter final : public std::pmr::memory_resource {
+    public:
+        uint64_t bytes = 0;
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+        [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override;
+    };
+
+    alignas(std::max_align_t) std::byte m_buffer[BUFFER_SIZE];
+    HeapCounter m_heap;
+    std::pmr::monotonic_buffer_resource m_monotonic;
+    Stats m_stats{};
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+    [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override;
+};
+
+#endif //MY2FA_COMMANDARENA_HPP
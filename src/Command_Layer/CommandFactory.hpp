@@ -1,13 +1,17 @@
 #ifndef MY2FA_COMMANDFACTORY_HPP
 #define MY2FA_COMMANDFACTORY_HPP
 #include <memory>
+#include <memory_resource>
 #include <vector>
 #include <sstream>
+#include <string_view>
 #include "Base/Command.hpp"
 
 class CommandFactory {
 public:
-    static std::unique_ptr<Command> create(const std::string &data);
+    // the resource only backs the parsing temporaries, never the returned command
+    static std::unique_ptr<Command> create(const std::string &data,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 };
 
 static std::vector<std::string> split(const std::string &s) {
@@ -20,4 +24,17 @@ static std::vector<std::string> split(const std::string &s) {
     return tokens;
 }
 
+// same as split, but the tokens are views into s, so only the vector itself is allocated
+static std::pmr::vector<std::string_view> splitViews(const std::string_view s, std::pmr::memory_resource *resource) {
+    std::pmr::vector<std::string_view> tokens(resource);
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t end = s.find(DELIMITER, start);
+        if (end == std::string_view::npos) end = s.size();
+        tokens.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return tokens;
+}
+
 #endif //MY2FA_COMMANDFACTORY_HPP
@@ -2,7 +2,9 @@
 #define MY2FA_CONTEXT_HPP
 
 #pragma once
+#include <map>
 #include <string>
+#include <vector>
 
 #include "Connection_Layer/ClientConnectionHandler.hpp"
 #ifdef A_SERVER
@@ -10,12 +12,14 @@ class SessionManager;
 class AuthManager;
 class ServerConnectionHandler;
 class TOTPManager;
+class FlowManager;
 
 struct Context {
     SessionManager &session_manager;
     AuthManager *auth_manager;
     ServerConnectionHandler &server_handler;
     TOTPManager *totp_manager;
+    FlowManager *flow_manager;
 };
 #endif
 // Dummy Server definition
@@ -50,6 +54,13 @@ struct Context {
     std::map<std::string, std::string> codes;
     std::vector<Notification> pendingNotifications;
     time_t timeExpiration;
+    uint64_t codesStep; // window the shown codes belong to
+    // pushed ahead of the window boundary, shown once the current codes expire
+    std::map<std::string, std::string> nextCodes;
+    uint64_t nextCodesStep;
+    time_t nextExpiration;
+    std::string resumeToken; // issued on login, lets a reconnect skip the credentials
+    std::vector<std::string> codeFilter; // apps the pushed codes are limited to, empty for all
 };
 #endif
 #ifdef D_CLIENT
@@ -4,12 +4,87 @@
 #include <utility>
 #if defined(A_SERVER) || defined(D_SERVER)
 #include "Auth_Layer/AuthManager.hpp"
+#include "Command_Layer/Base/Flow.hpp"
 #include "Command_Layer/Context.hpp"
 #include "Command_Layer/System_Commands/ErrorCommand.hpp"
 #include "Connection_Layer/ServerConnectionHandler.hpp"
 #include "Session_Manager/SessionManager.hpp"
 #include "Command_Layer/System_Commands/GenericResponseCommand.hpp"
 #include "Database_Layer/Database.hpp"
+
+namespace {
+    // the flows resume on the event loop once the hash pool is done; by then the client may
+    // have disconnected and its fd been reused, so the session is pinned before suspending
+    bool sameConnection(const Context &ctx, const int fd, const std::shared_ptr<Session> &session) {
+        return session && session->isValid && ctx.session_manager.getSession(fd) == session;
+    }
+
+    void sendBusy(Context &ctx, const int fd) {
+        std::cerr << "[AM Error] Hash pool full, rejecting credentials (fd = " << fd << ")\n";
+        ctx.server_handler.sendCommand(fd,
+            std::make_unique<ErrorCommand>(304,"Server busy, please try again!"));
+    }
+
+    Flow loginFlow(Context &ctx, const int fd, const std::string username, const std::string password) {
+        const std::shared_ptr<Session> session = ctx.session_manager.getSession(fd);
+        PasswordCheck check;
+        if (!co_await ctx.auth_manager->loginUser(username, password, check,
+                ctx.server_handler.getCommandResource())) {
+            sendBusy(ctx, fd);
+            co_return;
+        }
+        if (!sameConnection(ctx, fd, session)) co_return;
+        // a second LOGIN_REQ on the same connection may have finished first
+        if (ctx.session_manager.getIsLogged(fd)) {
+            ctx.server_handler.sendCommand(fd,
+                std::make_unique<ErrorCommand>(300,"User already logged in!"));
+            co_return;
+        }
+        if (!check.valid) {
+            std::cerr << "[AM Error] Login failed: "
+                << username <<" (fd = " << fd << ")\n";
+            ctx.server_handler.sendCommand(fd,
+                std::make_unique<ErrorCommand>(301,"Invalid username or password!"));
+            co_return;
+        }
+        std::cout << "[AM Log] Login successful: "
+            << username <<" (fd = " << fd << ")\n";
+        ctx.auth_manager->upgradePassword(username, check);
+
+        std::string resume_token;
+#ifdef A_SERVER
+        // another device of the user already holds the snapshot, only the first login reads it
+        PairingsPtr pairings = ctx.session_manager.getPairings(username);
+        if (!pairings) pairings = Pairings::fromMap(Database::getSecretPairings(username));
+        ctx.session_manager.completeLogin(fd, username, std::move(pairings));
+        resume_token = AuthManager::generateResumeToken();
+        ctx.session_manager.setResumeToken(fd, resume_token);
+#else
+        ctx.session_manager.completeLogin(fd, username);
+#endif
+        ctx.server_handler.sendCommand(fd,
+            std::make_unique<GenericResponseCommand>(CommandType::LOGIN_RESP, true, resume_token, username));
+        std::cout << "[Server] Sending Credential Command Response to Client: " << fd << "\n";
+    }
+
+    Flow registerFlow(Context &ctx, const int fd, const std::string username, const std::string password) {
+        const std::shared_ptr<Session> session = ctx.session_manager.getSession(fd);
+        PasswordHash hash;
+        if (!co_await ctx.auth_manager->hashPassword(password, hash)) {
+            sendBusy(ctx, fd);
+            co_return;
+        }
+        if (!sameConnection(ctx, fd, session)) co_return;
+        if (!ctx.auth_manager->registerUser(username, hash)) {
+            ctx.server_handler.sendCommand(fd,
+                std::make_unique<ErrorCommand>(302,"Username already taken!"));
+            co_return;
+        }
+        ctx.server_handler.sendCommand(fd,
+            std::make_unique<GenericResponseCommand>(CommandType::REGISTER_RESP, true, "", username));
+        std::cout << "[Server] Sending Credential Command Response to Client: " << fd << "\n";
+    }
+}
 #endif
 
 CredentialRequestCommand::CredentialRequestCommand(const CommandType type, std::string user, std::string pass):
@@ -26,6 +101,7 @@ void CredentialRequestCommand::execute(Context &ctx, const int fd) {
 #if defined(A_SERVER) || defined(D_SERVER)
     bool resp = false;
     CommandType resp_type;
+    std::string resume_token;
     //std::cout << "[DEBUG] type " << m_type << " | user " << m_username << " | pass " << m_password << "\n";
     if (m_type == CommandType::LOGIN_REQ) {
         if (ctx.session_manager.getIsLogged(fd)) {
@@ -34,25 +110,35 @@ void CredentialRequestCommand::execute(Context &ctx, const int fd) {
             std::cerr << "[AM Error] User already logged in!\n";
             return;
         }
-        if (ctx.auth_manager->loginUser(m_username,m_password)) {
-            ctx.session_manager.setIsLogged(fd, true);
-            std::cout << "[AM Log] Login successful: "
+        loginFlow(ctx, fd, m_username, m_password);
+    }
+
+#ifdef A_SERVER
+    // the password field carries the resumption token, a hit skips the database entirely
+    else if (m_type == CommandType::RESUME_REQ) {
+        if (ctx.session_manager.getIsLogged(fd)) {
+            ctx.server_handler.sendCommand(fd,
+                std::make_unique<ErrorCommand>(300,"User already logged in!"));
+            std::cerr << "[AM Error] User already logged in!\n";
+            return;
+        }
+        if (ctx.session_manager.resumeSession(fd, m_username, m_password)) {
+            std::cout << "[AM Log] Session resumed: "
                 << m_username <<" (fd = " << fd << ")\n";
             resp = true;
             resp_type = CommandType::LOGIN_RESP;
-            ctx.session_manager.setIdentity(fd, m_username);
-#ifdef A_SERVER
-            ctx.session_manager.setSecretPairings(fd, Database::getSecretPairings(m_username));
-#endif
+            // tokens are one-shot, hand out the next one
+            resume_token = AuthManager::generateResumeToken();
+            ctx.session_manager.setResumeToken(fd, resume_token);
         }
         else {
-            ctx.session_manager.setIsLogged(fd, false);
-            std::cerr << "[AM Error] Login failed: "
+            std::cerr << "[AM Error] Resumption failed: "
                 << m_username <<" (fd = " << fd << ")\n";
             ctx.server_handler.sendCommand(fd,
-                std::make_unique<ErrorCommand>(301,"Invalid username or password!"));
+                std::make_unique<ErrorCommand>(303,"Session expired, please login again!"));
         }
     }
+#endif
 
     else if (m_type == CommandType::REGISTER_REQ) {
         if (ctx.session_manager.getIsLogged(fd)) {
@@ -62,20 +148,12 @@ void CredentialRequestCommand::execute(Context &ctx, const int fd) {
             return;
         }
 
-        if (ctx.auth_manager->registerUser(m_username, m_password)) {
-            //std::cout << "[AM Log] User registered: " << m_username << "\n";
-            resp = true;
-            resp_type = CommandType::REGISTER_RESP;
-        } else {
-            //std::cerr << "[AM Error] Adding user failed: " << e.what() << "\n";
-            ctx.server_handler.sendCommand(fd,
-                std::make_unique<ErrorCommand>(302,"Username already taken!"));
-        }
+        registerFlow(ctx, fd, m_username, m_password);
     }
 
     if (resp) {
         ctx.server_handler.sendCommand(fd,
-            std::make_unique<GenericResponseCommand>(resp_type, resp, "", m_username));
+            std::make_unique<GenericResponseCommand>(resp_type, resp, resume_token, m_username));
         std::cout << "[Server] Sending Credential Command Response to Client: " << fd << "\n";
     }
 #endif
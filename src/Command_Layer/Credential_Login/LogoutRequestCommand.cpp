@@ -16,8 +16,8 @@ std::string LogoutRequestCommand::serialize() const {
 
 void LogoutRequestCommand::execute(Context &ctx, int client_fd) {
 #if defined(A_SERVER) || defined(D_SERVER)
-    if (ctx.session_manager.getIsLogged(client_fd)) {
-        std::cout << "[Server] User logged out: " << ctx.session_manager.getIdentity(client_fd) << "\n";
+    if (const auto session = ctx.session_manager.getSnapshot(client_fd); session && session->isLogged) {
+        std::cout << "[Server] User logged out: " << session->identity << "\n";
         ctx.session_manager.logout(client_fd);
     }
     else {
@@ -0,0 +1,70 @@
+#include "FlowManager.hpp"
+#include <iostream>
+#include <ranges>
+#include <utility>
+
+FlowManager::ReplyAwaiter::ReplyAwaiter(FlowManager &manager, std::string key, const Clock::time_point deadline)
+    : m_manager(manager), m_key(std::move(key)), m_deadline(deadline) {}
+
+void FlowManager::ReplyAwaiter::await_suspend(const std::coroutine_handle<> handle) {
+    m_handle = handle;
+    m_manager.m_register(this);
+}
+
+FlowManager::~FlowManager() {
+    // flows still waiting at shutdown never get their reply, free their frames
+    for (const auto &awaiter: m_waiting | std::views::values) {
+        awaiter->m_handle.destroy();
+    }
+}
+
+FlowManager::ReplyAwaiter FlowManager::awaitReply(const FlowKind kind, const std::string &key,
+                                                  const std::chrono::seconds timeout) {
+    return {*this, m_key(kind, key), Clock::now() + timeout};
+}
+
+bool FlowManager::resume(const FlowKind kind, const std::string &key, FlowReply reply) {
+    const auto it = m_waiting.find(m_key(kind, key));
+    if (it == m_waiting.end()) return false;
+
+    ReplyAwaiter *awaiter = it->second;
+    m_waiting.erase(it);
+    m_deadlines.erase(awaiter->m_deadline_it);
+    awaiter->m_reply = std::move(reply);
+    awaiter->m_handle.resume(); // the awaiter may be gone after this
+    return true;
+}
+
+void FlowManager::update() {
+    const auto now = Clock::now();
+    while (!m_deadlines.empty() && m_deadlines.begin()->first <= now) {
+        const std::string key = m_deadlines.begin()->second;
+        m_deadlines.erase(m_deadlines.begin());
+
+        const auto it = m_waiting.find(key);
+        if (it == m_waiting.end()) continue;
+        ReplyAwaiter *awaiter = it->second;
+        m_waiting.erase(it);
+        std::cout << "[FM Log] Flow " << key << " timed out\n";
+        awaiter->m_handle.resume(); // m_reply stays empty
+    }
+}
+
+size_t FlowManager::pendingCount() const {
+    return m_waiting.size();
+}
+
+std::string FlowManager::m_key(const FlowKind kind, const std::string &key) {
+    return (kind == FlowKind::PAIRING ? "pair:" : "notif:") + key;
+}
+
+void FlowManager::m_register(ReplyAwaiter *awaiter) {
+    awaiter->m_deadline_it = m_deadlines.emplace(awaiter->m_deadline, awaiter->m_key);
+    if (const auto [it, inserted] = m_waiting.emplace(awaiter->m_key, awaiter); !inserted) {
+        // keys are random tokens, a clash means the older flow can never be answered
+        std::cerr << "[FM Error] Flow key " << awaiter->m_key << " already in use!\n";
+        m_deadlines.erase(it->second->m_deadline_it);
+        it->second->m_handle.destroy();
+        it->second = awaiter;
+    }
+}
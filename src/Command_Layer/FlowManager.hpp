@@ -0,0 +1,77 @@
+#ifndef MY2FA_FLOWMANAGER_HPP
+#define MY2FA_FLOWMANAGER_HPP
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <coroutine>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "Base/Flow.hpp"
+
+// what a suspended flow waits for; pairing tokens and notification reqIDs are both short
+// random strings, so each kind gets its own key space and a reply can't cross over
+enum class FlowKind : uint8_t {
+    PAIRING,
+    NOTIFICATION,
+};
+
+// what the remote side answered to a suspended flow
+struct FlowReply {
+    int fd;
+    bool accepted;
+    std::string identity;
+};
+
+// Keeps the flows that are suspended until a remote reply (or their timeout) arrives.
+// Replies are matched by key (reqID, pairing token), so no scans are needed.
+class FlowManager {
+    using Clock = std::chrono::steady_clock;
+    using Deadlines = std::multimap<Clock::time_point, std::string>;
+
+public:
+    class ReplyAwaiter {
+    public:
+        ReplyAwaiter(FlowManager &manager, std::string key, Clock::time_point deadline);
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        std::optional<FlowReply> await_resume() { return std::move(m_reply); }
+
+    private:
+        friend class FlowManager;
+        FlowManager &m_manager;
+        std::string m_key;
+        Clock::time_point m_deadline;
+        Deadlines::iterator m_deadline_it;
+        std::coroutine_handle<> m_handle;
+        std::optional<FlowReply> m_reply;
+    };
+
+    FlowManager() = default;
+    ~FlowManager();
+
+    FlowManager(const FlowManager &) = delete;
+    FlowManager &operator=(const FlowManager &) = delete;
+
+    // co_await the result; std::nullopt means the flow timed out
+    [[nodiscard]] ReplyAwaiter awaitReply(FlowKind kind, const std::string &key, std::chrono::seconds timeout);
+    // returns false if no flow of that kind is waiting on that key
+    bool resume(FlowKind kind, const std::string &key, FlowReply reply);
+    // wakes up the flows whose timeout passed, called from the event loop
+    void update();
+
+    [[nodiscard]] size_t pendingCount() const;
+
+private:
+    std::unordered_map<std::string, ReplyAwaiter *> m_waiting;
+    Deadlines m_deadlines;
+
+    void m_register(ReplyAwaiter *awaiter);
+    // "pair:<token>" / "notif:<reqID>"
+    [[nodiscard]] static std::string m_key(FlowKind kind, const std::string &key);
+};
+
+#endif //MY2FA_FLOWMANAGER_HPP
@@ -1,4 +1,5 @@
 #include "RequestNotificationCommand.hpp"
+#include <algorithm>
 #include <sstream>
 
 #include "Auth_Layer/AuthManager.hpp"
@@ -8,8 +9,36 @@
 #include "Command_Layer/Context.hpp"
 #elif defined(A_SERVER)
 #include "Command_Layer/Context.hpp"
+#include "Command_Layer/FlowManager.hpp"
+#include "Command_Layer/System_Commands/GenericResponseCommand.hpp"
 #include "Database_Layer/Database.hpp"
 #include "Connection_Layer/ClientConnectionHandler.hpp"
+
+namespace {
+    constexpr auto NOTIFICATION_TIMEOUT = std::chrono::seconds(60);
+
+    // DS -> AS -> AC -> AS -> DS, parameters are taken by value so they live in the frame
+    Flow notificationFlow(Context &ctx, const int ds_fd, const std::string username, const std::string app_id) {
+        std::string reqID;
+        const std::vector<int> ac_fds =
+            ctx.auth_manager->startNotification(username, app_id, reqID, ctx.session_manager);
+        if (ac_fds.empty()) co_return;
+
+        // every device of the user gets it, the first answer wins
+        for (const int ac_fd: ac_fds) {
+            ctx.server_handler.sendCommand(ac_fd,
+                std::make_unique<SendNotificationCommand>(reqID, app_id));
+            std::cout << "[AS Log] Sending Notification to Client: " << ac_fd << "\n";
+        }
+
+        const auto reply = co_await ctx.flow_manager->awaitReply(FlowKind::NOTIFICATION, reqID, NOTIFICATION_TIMEOUT);
+        if (!reply) std::cerr << "[AS Error] Notification " << reqID << " timed out!\n";
+        const bool accepted = reply && std::ranges::find(ac_fds, reply->fd) != ac_fds.end() && reply->accepted;
+
+        ctx.server_handler.sendCommand(ds_fd,
+            std::make_unique<GenericResponseCommand>(CommandType::NOTIF_LOGIN_RESP, accepted, reqID, username));
+    }
+}
 #endif
 
 RequestNotificationCommand::RequestNotificationCommand(std::string username, std::string app_id):
@@ -26,13 +55,7 @@ void RequestNotificationCommand::execute(Context &ctx, const int client_fd) {
     ctx.client_handler->sendCommand(
         std::make_unique<RequestNotificationCommand>(m_username, ctx.app_id));
 #elif defined(A_SERVER)
-    std::string reqID;
-    if (const int ac_fd = ctx.auth_manager->startNotification(
-        m_username, m_app_id, reqID, client_fd, ctx.session_manager); ac_fd > 0) {
-        ctx.server_handler.sendCommand(ac_fd,
-            std::make_unique<SendNotificationCommand>(reqID, m_app_id));
-        std::cout << "[AS Log] Sending Notification to Client: " << ac_fd << "\n";
-    }
+    notificationFlow(ctx, client_fd, m_username, m_app_id);
 #endif
 }
 
@@ -5,12 +5,15 @@
 #if defined(A_CLIENT) || defined(D_CLIENT)
 #include "Command_Layer/Context.hpp"
 #include "Connection_Layer/ClientConnectionHandler.hpp"
+#ifdef A_CLIENT
+#include "Command_Layer/Code_Login/SubscribeCodesCommand.hpp"
+#endif
 #elif defined(D_SERVER)
 #include "Command_Layer/Context.hpp"
 #include "Connection_Layer/ClientConnectionHandler.hpp"
 #elif defined(A_SERVER)
 #include "Command_Layer/Context.hpp"
-#include "Auth_Layer/AuthManager.hpp"
+#include "Command_Layer/FlowManager.hpp"
 #endif
 
 GenericResponseCommand::GenericResponseCommand(const CommandType type, const bool resp,
@@ -32,6 +35,12 @@ void GenericResponseCommand::execute(Context &ctx, int fd) {
             if (m_resp) {
                 ctx.isLogged = true;
                 ctx.username = m_extra;
+#ifdef A_CLIENT
+                ctx.resumeToken = m_msg;
+                // a fresh session on the AS pushes every app, restore the client's filter
+                if (!ctx.codeFilter.empty())
+                    ctx.client_handler->sendCommand(std::make_unique<SubscribeCodesCommand>(ctx.codeFilter));
+#endif
                 std::cout << "[Client] Login successful for user " << m_extra << "!\n";
             } else {
                 ctx.isLogged = false;
@@ -59,7 +68,8 @@ void GenericResponseCommand::execute(Context &ctx, int fd) {
             else if (m_resp && m_msg.empty() && !m_extra.empty()) {
                 std::cout << "[2FA Pairing] Pairing completed for user " << m_extra << "!\n";
             }
-            else std::cerr << "[2FA Pairing] A pairing request already exists for " << m_extra << "!\n";
+            // refused up front (one is already pending) or failed to be stored once confirmed
+            else std::cerr << "[2FA Pairing] Pairing failed for " << m_extra << "!\n";
 #endif
             break;
         case::CommandType::CODE_CHK_RESP:
@@ -70,14 +80,8 @@ void GenericResponseCommand::execute(Context &ctx, int fd) {
             break;
         case CommandType::NOTIF_RESP: {
 #ifdef A_SERVER
-            std::cout << "[DEBUG] MERGE\n";
-            std::string d_username;
-            if (const int ds_fd = ctx.auth_manager->finishNotification(m_msg, d_username); ds_fd > 0) {
-                ctx.server_handler.sendCommand(ds_fd,
-                    std::make_unique<GenericResponseCommand>(CommandType::NOTIF_LOGIN_RESP,
-                            m_resp, m_msg, d_username));
-            }
-            else std::cerr << "[AS Error] Could not find pending notification for client " << m_msg << "!\n";
+            if (!ctx.flow_manager->resume(FlowKind::NOTIFICATION, m_msg, {fd, m_resp, ctx.session_manager.getIdentity(fd)}))
+                std::cerr << "[AS Error] Could not find pending notification for client " << m_msg << "!\n";
 #endif
             break;
         }
@@ -11,16 +11,51 @@
 #include "Session_Manager/SessionManager.hpp"
 #include "Connection_Layer/ServerConnectionHandler.hpp"
 #include "Auth_Layer/AuthManager.hpp"
+#include "Command_Layer/FlowManager.hpp"
+
+namespace {
+    constexpr auto PAIRING_TIMEOUT = std::chrono::seconds(300);
+
+    // DS asks for a token, the AC later sends that token back through VALIDATE_CODE_CLIENT
+    Flow pairingFlow(Context &ctx, const int ds_fd, const std::string d_username, const std::string app_id,
+                     const TOTPParams params) {
+        const auto pairing = ctx.auth_manager->startPairing(d_username, app_id, params);
+        ctx.server_handler.sendCommand(ds_fd,
+            std::make_unique<GenericResponseCommand>(CommandType::PAIR_RESP, pairing.has_value(),
+                pairing ? pairing->token : "", d_username));
+        if (!pairing) co_return;
+
+        const auto reply = co_await ctx.flow_manager->awaitReply(FlowKind::PAIRING, pairing->token, PAIRING_TIMEOUT);
+        if (!reply || !reply->accepted || reply->identity.empty()) {
+            std::cerr << "[AS Error] Pairing for " << d_username << " was not completed!\n";
+            ctx.auth_manager->cancelPairing(*pairing);
+            co_return;
+        }
+        if (!ctx.auth_manager->finishPairing(reply->identity, *pairing)) {
+            std::cerr << "[AS Error] Storing the pairing for " << d_username << " failed!\n";
+            ctx.auth_manager->cancelPairing(*pairing);
+            ctx.server_handler.sendCommand(ds_fd,
+                std::make_unique<GenericResponseCommand>(CommandType::PAIR_RESP, false, "", d_username));
+            co_return;
+        }
+
+        ctx.session_manager.addSecretPairing(reply->fd, pairing->app_id, {pairing->secret, pairing->params});
+        // empty token tells the DC that the pairing is done
+        ctx.server_handler.sendCommand(ds_fd,
+            std::make_unique<GenericResponseCommand>(CommandType::PAIR_RESP, true, "", d_username));
+    }
+}
 #endif
 
-PairCommand::PairCommand(std::string d_username):
-    m_d_username(std::move(d_username)) {}
+PairCommand::PairCommand(std::string d_username, std::string params):
+    m_d_username(std::move(d_username)), m_params(std::move(params)) {}
 
 std::string PairCommand::serialize() const {
     std::stringstream ss;
     ss << static_cast<int>(CommandType::PAIR_REQ);
 #ifdef D_SERVER
     ss << DELIMITER << m_d_username;
+    if (!m_params.empty()) ss << DELIMITER << m_params;
 #endif
     return ss.str();
 }
@@ -31,12 +66,15 @@ void PairCommand::execute(Context &ctx, const int fd) {
     ctx.client_handler->sendCommand(
         std::make_unique<PairCommand>(ctx.session_manager.getIdentity(fd)));
 #elif defined(A_SERVER)
-    std::string token = ctx.auth_manager->startPairing(m_d_username, ctx.session_manager.getIdentity(fd));
-    //std::cout << "[DEBUG] token = " << token << "\n";
-    bool resp = true;
-    if (token.empty()) resp = false;
-    ctx.server_handler.sendCommand(fd,
-            std::make_unique<GenericResponseCommand>(CommandType::PAIR_RESP, resp, token, m_d_username));
+    std::optional<TOTPParams> params = DEFAULT_TOTP_PARAMS;
+    if (!m_params.empty()) params = TOTPParams::parse(m_params);
+    if (!params) {
+        std::cerr << "[AS Error] Unsupported TOTP parameters: " << m_params << "\n";
+        ctx.server_handler.sendCommand(fd,
+            std::make_unique<GenericResponseCommand>(CommandType::PAIR_RESP, false, "", m_d_username));
+        return;
+    }
+    pairingFlow(ctx, fd, m_d_username, ctx.session_manager.getIdentity(fd), *params);
 #endif
 }
 
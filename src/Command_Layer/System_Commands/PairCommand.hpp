@@ -5,7 +5,8 @@
 
 class PairCommand : public Command {
 public:
-    explicit PairCommand(std::string d_username);
+    // params is empty for the default TOTP variant, otherwise e.g. "SHA256/8/60"
+    explicit PairCommand(std::string d_username, std::string params = "");
     PairCommand() = default;
 
     [[nodiscard]] std::string serialize() const override;
@@ -17,6 +18,7 @@ public:
 
 private:
     const std::string m_d_username;
+    const std::string m_params;
     const std::string m_code;
 };
 
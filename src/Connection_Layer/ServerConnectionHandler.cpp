@@ -7,6 +7,7 @@
 #include <iostream>
 #include <sys/socket.h>
 #include <unistd.h>
+#include "Command_Layer/CommandArena.hpp"
 #include "Command_Layer/CommandFactory.hpp"
 
 ServerConnectionHandler::ServerConnectionHandler(const int port) : m_port(port), m_socket(-1) {
@@ -26,6 +27,13 @@ void ServerConnectionHandler::setDisconnectCallback(const DisconnectCallback &ca
     m_disconnectCallback = callback;
 }
 
+void ServerConnectionHandler::setCommandArena(CommandArena *arena) { m_arena = arena; }
+
+std::pmr::memory_resource *ServerConnectionHandler::getCommandResource() const {
+    if (m_arena) return m_arena;
+    return std::pmr::get_default_resource();
+}
+
 int ServerConnectionHandler::getSocket() const { return m_socket; }
 
 bool ServerConnectionHandler::isRunning() const { return m_socket > 0; }
@@ -90,7 +98,10 @@ void ServerConnectionHandler::update() {
 }
 
 void ServerConnectionHandler::sendCommand(const int client_sd, const std::unique_ptr<Command> &cmd) const {
-    const std::string data = cmd->serialize();
+    sendData(client_sd, cmd->serialize());
+}
+
+void ServerConnectionHandler::sendData(const int client_sd, const std::string &data) const {
     std::lock_guard<std::mutex> lock(m_mutex);
     if (fcntl(client_sd, F_GETFD) != -1) {
         send(client_sd, data.c_str(), data.length(), 0);
@@ -165,12 +176,13 @@ bool ServerConnectionHandler::m_handleData(const int client_sd) const {
     const std::string data(buffer, valread);
     std::unique_ptr<Command> command;
     try {
-        command = CommandFactory::create(data);
+        command = CommandFactory::create(data, getCommandResource());
     } catch (...) {
         command = nullptr;
     }
     if (m_commandCallback && command)
         m_commandCallback(client_sd, std::move(command));
+    if (m_arena) m_arena->reset();
     return true;
 }
 
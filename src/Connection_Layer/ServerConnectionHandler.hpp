@@ -3,9 +3,12 @@
 
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include "../Command_Layer/Base/Command.hpp"
 
+class CommandArena;
+
 
 class ServerConnectionHandler {
 public:
@@ -23,6 +26,11 @@ public:
     void setCommandCallback(const CommandCallback &callback);
     void setConnectCallback(const ConnectCallback &callback);
     void setDisconnectCallback(const DisconnectCallback &callback);
+    // received commands are parsed and executed inside the arena, which is reset after each one
+    void setCommandArena(CommandArena *arena);
+
+    // memory for temporaries of the command currently being executed
+    [[nodiscard]] std::pmr::memory_resource *getCommandResource() const;
 
     [[nodiscard]] int getSocket() const;
 
@@ -32,6 +40,7 @@ public:
 
     // ReSharper disable once CppMemberFunctionMayBeStatic
     void sendCommand(int client_sd, const std::unique_ptr<Command> &cmd) const;
+    void sendData(int client_sd, const std::string &data) const; // already serialized commands
     void broadcastCommand(const std::unique_ptr<Command> &cmd) const;
 
 private:
@@ -39,6 +48,7 @@ private:
     int m_socket;
     std::vector<int> m_client_sockets;
     mutable std::mutex m_mutex;
+    CommandArena *m_arena = nullptr;
 
     CommandCallback m_commandCallback;
     ConnectCallback m_connectCallback;
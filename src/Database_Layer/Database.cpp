@@ -4,9 +4,76 @@
 #include <optional>
 #include <map>
 #include <SQLiteCpp/SQLiteCpp.h>
+#include "UsernameFilter.hpp"
 
 namespace Database {
     static std::unique_ptr<SQLite::Database> db = nullptr;
+    static UsernameFilter usernames;
+    static uint64_t filtered_lookups = 0; // getUser calls the filter answered on its own
+
+    // streams the users table into the filter, sized with room to grow before the next rebuild
+    static void buildUsernameFilter() {
+        SQLite::Statement count(*db, "SELECT COUNT(*) FROM users");
+        usernames.reset(count.executeStep() ? 2 * static_cast<size_t>(count.getColumn(0).getInt64()) : 0);
+        SQLite::Statement query(*db, "SELECT username FROM users");
+        while (query.executeStep()) usernames.add(query.getColumn(0).getText());
+    }
+
+#ifdef A_SERVER
+    // pairs tables created before the TOTP parameter columns get them with the old fixed values
+    static void migratePairs() {
+        bool has_params = false;
+        SQLite::Statement columns(*db, "PRAGMA table_info(pairs)");
+        while (columns.executeStep()) {
+            if (columns.getColumn(1).getString() == "algorithm") has_params = true;
+        }
+        if (has_params) return;
+
+        SQLite::Transaction transaction(*db);
+        db->exec("ALTER TABLE pairs ADD COLUMN algorithm TEXT NOT NULL DEFAULT 'SHA1'");
+        db->exec("ALTER TABLE pairs ADD COLUMN digits INTEGER NOT NULL DEFAULT 6");
+        db->exec("ALTER TABLE pairs ADD COLUMN period INTEGER NOT NULL DEFAULT 30");
+        transaction.commit();
+        std::cout << "[DB Log] Added TOTP parameter columns to pairs\n";
+    }
+
+    // totp_secret used to be fed to the HMAC as text; it now holds the base32 of the raw key.
+    // Old rows are re-encoded so that they decode to their old text, keeping their codes.
+    // user_version 1 marks a pairs table already in the new form.
+    static void migrateSecrets() {
+        SQLite::Statement version(*db, "PRAGMA user_version");
+        if (version.executeStep() && version.getColumn(0).getInt() >= 1) return;
+
+        SQLite::Transaction transaction(*db);
+        SQLite::Statement rows(*db, "SELECT rowid, totp_secret FROM pairs");
+        SQLite::Statement update(*db, "UPDATE pairs SET totp_secret = ? WHERE rowid = ?");
+        size_t migrated = 0;
+        while (rows.executeStep()) {
+            const SQLite::Column text = rows.getColumn(1);
+            update.bind(1, TOTPKey(text.getText(), text.getBytes()).toBase32());
+            update.bind(2, rows.getColumn(0).getInt64());
+            update.exec();
+            update.reset();
+            migrated++;
+        }
+        db->exec("PRAGMA user_version = 1");
+        transaction.commit();
+        if (migrated > 0) std::cout << "[DB Log] Re-encoded " << migrated << " pairing secrets as raw keys\n";
+    }
+#endif
+
+    static PairingSecret readPairingSecret(SQLite::Statement &query, const int first) {
+        const TOTPParams params{
+            TOTPParams::parseAlgorithm(query.getColumn(first + 1).getString()).value_or(DEFAULT_TOTP_PARAMS.algorithm),
+            static_cast<uint8_t>(query.getColumn(first + 2).getInt()),
+            static_cast<uint16_t>(query.getColumn(first + 3).getInt())};
+        if (!params.isSupported())
+            std::cerr << "[DB Error] Unsupported TOTP parameters " << params.toString() << ", using defaults\n";
+        // decoded straight from SQLite's buffer, the text never lands in a std::string
+        std::optional<TOTPKey> key = TOTPKey::fromBase32(query.getColumn(first).getText());
+        if (!key) std::cerr << "[DB Error] Pairing secret is not valid base32\n";
+        return {key.value_or(TOTPKey{}), params.isSupported() ? params : DEFAULT_TOTP_PARAMS};
+    }
 
     void init(const std::string &server_type) {
         try {
@@ -28,14 +95,20 @@ namespace Database {
                     "d_username TEXT NOT NULL,"
                     "app_id TEXT NOT NULL,"
                     "totp_secret TEXT NOT NULL,"
+                    "algorithm TEXT NOT NULL DEFAULT 'SHA1',"
+                    "digits INTEGER NOT NULL DEFAULT 6,"
+                    "period INTEGER NOT NULL DEFAULT 30,"
                     "PRIMARY KEY(d_username, app_id),"
                     "FOREIGN KEY(a_username) REFERENCES users(username) ON DELETE CASCADE)");
+            migratePairs();
+            migrateSecrets();
 #else
             db->exec("CREATE TABLE IF NOT EXISTS users ("
                    "username TEXT PRIMARY KEY NOT NULL,"
                    "pass_hash TEXT NOT NULL,"
                    "salt TEXT NOT NULL)");
 #endif
+            buildUsernameFilter();
         } catch (std::exception& e) {
             std::cerr << "[DB Error] Init error: " << e.what() << "\n";
         }
@@ -45,11 +118,13 @@ namespace Database {
         if (!db) return false;
         try {
             SQLite::Statement query(*db, "INSERT INTO users (username, pass_hash, salt) VALUES (?, ?, ?)");
-            query.bind(1, user.username);
-            query.bind(2, user.pass_hash);
-            query.bind(3, user.salt);
+            query.bind(1, user.username.c_str());
+            query.bind(2, user.pass_hash.c_str());
+            query.bind(3, user.salt.c_str());
             query.exec();
             std::cout << "[DB Log] User created: " << user.username << "\n";
+            usernames.add(user.username);
+            if (usernames.isFull()) buildUsernameFilter();
             return true;
         } catch (std::exception& e) {
             std::cerr << "[DB Error] Creating user failed: " << e.what() << "\n";
@@ -57,17 +132,27 @@ namespace Database {
         }
     }
 
-    std::optional<UserDTO> getUser(const std::string &username) {
+    std::optional<UserDTO> getUser(const std::string &username, std::pmr::memory_resource *resource) {
         if (!db) return std::nullopt;
+        if (!usernames.mayContain(username)) {
+            filtered_lookups++;
+            return std::nullopt;
+        }
         try {
             SQLite::Statement query(*db, "SELECT * FROM users WHERE username = ?");
             query.bind(1, username);
 
-            query.executeStep();
-            UserDTO user;
-            user.username = query.getColumn(0).getString();
-            user.pass_hash = query.getColumn(1).getString();
-            user.salt = query.getColumn(2).getString();
+            // a filter false positive, no need to go through the exception below
+            if (!query.executeStep()) return std::nullopt;
+            // getText avoids the intermediate std::string that getString would allocate
+            UserDTO user{std::pmr::string(query.getColumn(0).getText(), resource),
+                         std::pmr::string(query.getColumn(1).getText(), resource),
+                         std::pmr::string(query.getColumn(2).getText(), resource)
+#ifdef A_SERVER
+                         // not a users column, left empty but still in the caller's arena
+                         , std::pmr::string(resource)
+#endif
+            };
             return user;
         } catch (std::exception &e) {
             std::cerr << "[DB Error] Getting user failed: " << e.what() << "\n";
@@ -76,15 +161,18 @@ namespace Database {
     }
 
     bool pairUser(const std::string &a_username, const std::string &d_username,
-                  const std::string &app_id, const std::string &secret) {
+                  const std::string &app_id, const PairingSecret &secret) {
         if (!db) return true;
         try {
-            SQLite::Statement query(*db, "INSERT INTO pairs (a_username, d_username, "
-                                                "app_id, totp_secret) VALUES (?, ?, ?, ?)");
+            SQLite::Statement query(*db, "INSERT INTO pairs (a_username, d_username, app_id, "
+                                                "totp_secret, algorithm, digits, period) VALUES (?, ?, ?, ?, ?, ?, ?)");
             query.bind(1, a_username);
             query.bind(2, d_username);
             query.bind(3, app_id);
-            query.bind(4, secret);
+            query.bind(4, secret.secret.toBase32());
+            query.bind(5, std::string(TOTPParams::algorithmName(secret.params.algorithm)));
+            query.bind(6, secret.params.digits);
+            query.bind(7, secret.params.period);
             query.exec();
             std::cout << "[DB Log] Pairing created: " << a_username << " - " << d_username << "\n";
             return true;
@@ -108,13 +196,28 @@ namespace Database {
         }
     }
 
+    bool updatePassword(const std::string &username, const std::string &pass_hash) {
+        if (!db) return false;
+
+        try {
+            SQLite::Statement query(*db, "UPDATE users SET pass_hash = ? WHERE username = ?");
+            query.bind(1, pass_hash);
+            query.bind(2, username);
+            return query.exec() > 0;
+        } catch (std::exception &e) {
+            std::cerr << "[DB Error] Updating password failed: " << e.what() << "\n";
+            return false;
+        }
+    }
+
     void removeUser(const std::string &username) {
         if (!db) return;
 
         try {
             SQLite::Statement query(*db, "DELETE FROM users WHERE username = ?");
             query.bind(1, username);
-            query.exec();
+            if (query.exec() == 0) return;
+            usernames.remove(username);
             std::cout << "[DB Log] User removed: " << username << "\n";
         } catch (std::exception &e) {
             std::cerr << "[DB Error] Removing user failed: " << e.what() << "\n";
@@ -151,30 +254,32 @@ namespace Database {
         }
     }
 
-    std::optional<std::string> getSecret(const std::string &d_username, const std::string &app_id) {
+    std::optional<PairingSecret> getSecret(const std::string &d_username, const std::string &app_id) {
         if (!db) return std::nullopt;
         try {
-            SQLite::Statement query(*db, "SELECT totp_secret FROM pairs WHERE d_username = ? AND app_id = ?");
+            SQLite::Statement query(*db, "SELECT totp_secret, algorithm, digits, period FROM pairs "
+                                         "WHERE d_username = ? AND app_id = ?");
             query.bind(1, d_username);
             query.bind(2, app_id);
             query.executeStep();
-            std::cout << "[DB Log] Secret found: " << query.getColumn(0) << "\n";
-            return query.getColumn(0);
+            std::cout << "[DB Log] Secret found for " << d_username << " - " << app_id << "\n";
+            return readPairingSecret(query, 0);
         } catch (std::exception &e) {
             std::cerr << "[DB Error] Secret lookup failed: " << e.what() << "\n";
             return std::nullopt;
         }
     }
 
-    std::map<std::string, std::string> getSecretPairings(const std::string &username) {
-        std::map<std::string, std::string> pairings;
+    std::map<std::string, PairingSecret> getSecretPairings(const std::string &username) {
+        std::map<std::string, PairingSecret> pairings;
         if (!db) return pairings;
         try {
-            SQLite::Statement query(*db, "SELECT app_id, totp_secret FROM pairs WHERE a_username = ?");
+            SQLite::Statement query(*db, "SELECT app_id, totp_secret, algorithm, digits, period FROM pairs "
+                                         "WHERE a_username = ?");
             query.bind(1, username);
             while (query.executeStep()) {
                 // app_id -> secret
-                pairings[query.getColumn(0).getString()] = query.getColumn(1).getString();
+                pairings[query.getColumn(0).getString()] = readPairingSecret(query, 1);
             }
         } catch (std::exception &e) {
             std::cerr << "[DB Error] Secret pairings lookup failed: " << e.what() << "\n";
@@ -191,12 +296,15 @@ namespace Database {
             std::cout << "username = " << query.getColumn(0) << " | pass_hash = " << query.getColumn(1)
                 << " | salt = " << query.getColumn(2) << "\n";
         }
+        std::cout << "[DB Log] Username filter: " << usernames.size() << "/" << usernames.capacity() << " names"
+            << " | " << usernames.bytes() << " bytes | Lookups answered without a query: " << filtered_lookups << "\n";
 #ifdef A_SERVER
         std::cout << "\n[DB Log] Pairings:\n";
         SQLite::Statement query2(*db, "SELECT * FROM pairs");
         while (query2.executeStep()) {
             std::cout << "a_username = " << query2.getColumn(0) << " | d_username = " << query2.getColumn(1)
-                << " | app_id = " << query2.getColumn(2) << " | totp_secret = " << query2.getColumn(3) << "\n";
+                << " | app_id = " << query2.getColumn(2) << " | totp_secret = " << query2.getColumn(3)
+                << " | totp = " << query2.getColumn(4) << "/" << query2.getColumn(5) << "/" << query2.getColumn(6) << "\n";
         }
 #endif
     }
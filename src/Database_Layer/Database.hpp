@@ -1,15 +1,19 @@
 #ifndef MY2FA_DATABASE_HPP
 #define MY2FA_DATABASE_HPP
 #include <SQLiteCpp/Database.h>
+#include <map>
+#include <memory_resource>
 #include <optional>
+#include "TOTP_Layer/TOTPParams.hpp"
 
 namespace Database {
+    // pmr strings so that a login can build the DTO inside the per-command arena
     struct UserDTO {
-        std::string username;
-        std::string pass_hash;
-        std::string salt;
+        std::pmr::string username;
+        std::pmr::string pass_hash;
+        std::pmr::string salt;
 #ifdef A_SERVER
-        std::string totp_secret;
+        std::pmr::string totp_secret;
 #endif
     };
 
@@ -17,17 +21,20 @@ namespace Database {
 
     [[nodiscard]] bool createUser(const UserDTO &user);
 
-    [[nodiscard]] std::optional<UserDTO> getUser(const std::string &username);
+    [[nodiscard]] std::optional<UserDTO> getUser(const std::string &username,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
     [[nodiscard]] bool pairUser(const std::string &a_username,
-        const std::string &d_username, const std::string &app_id, const std::string &secret);
-    [[nodiscard]] std::optional<std::string> getSecret(const std::string &d_username, const std::string &app_id);
+        const std::string &d_username, const std::string &app_id, const PairingSecret &secret);
+    [[nodiscard]] std::optional<PairingSecret> getSecret(const std::string &d_username, const std::string &app_id);
 
     void updateSecret(const std::string &username, const std::string &secret);
+    // pass_hash is the encoded "pbkdf2-sha256$<iterations>$<hex>" form, the salt is kept
+    [[nodiscard]] bool updatePassword(const std::string &username, const std::string &pass_hash);
     void removeUser(const std::string &username);
 
     [[nodiscard]] std::optional<std::string> getD_username(const std::string &a_username, const std::string &app_id);
     [[nodiscard]] std::optional<std::string> getA_username(const std::string &d_username, const std::string &app_id);
-    [[nodiscard]] std::map<std::string, std::string> getSecretPairings(const std::string &username);
+    [[nodiscard]] std::map<std::string, PairingSecret> getSecretPairings(const std::string &username);
     void show();
 }
 
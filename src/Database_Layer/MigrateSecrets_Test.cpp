@@ -0,0 +1,72 @@
+#include <filesystem>
+#include <string>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "Database.hpp"
+#include "TOTP_Layer/TOTPGenerator.hpp"
+#include "TOTP_Layer/TOTPKey.hpp"
+#include "Test_Layer/TestCheck.hpp"
+
+// Pairings made while totp_secret was fed to the HMAC as text are re-encoded by Database::init
+// so that they decode to that same text, and keep producing the codes their apps show.
+namespace {
+    using TestCheck::expect;
+
+    constexpr std::string_view SERVER_TYPE = "migrate_test";
+    // RFC 6238's SHA-1 key, its code at T = 59 is 94287082, so 287082 with 6 digits
+    constexpr std::string_view RFC_SECRET = "12345678901234567890";
+    constexpr uint32_t RFC_CODE = 287082;
+    // what the pairings stored before, base32 text used as is, 32 bytes
+    constexpr std::string_view OLD_SECRET = "JBSWY3DPEHPK3PXPJBSWY3DPEHPK3PXP";
+
+    // a pairs table as it was before the parameter columns and raw keys
+    void createOldDatabase(const std::filesystem::path &path) {
+        SQLite::Database db(path.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        db.exec("CREATE TABLE users (username TEXT PRIMARY KEY NOT NULL, pass_hash TEXT NOT NULL, salt TEXT NOT NULL)");
+        db.exec("CREATE TABLE pairs (a_username TEXT NOT NULL, d_username TEXT NOT NULL, app_id TEXT NOT NULL,"
+                "totp_secret TEXT NOT NULL, PRIMARY KEY(d_username, app_id),"
+                "FOREIGN KEY(a_username) REFERENCES users(username) ON DELETE CASCADE)");
+        db.exec("INSERT INTO users VALUES ('alice', 'hash', 'salt')");
+        SQLite::Statement insert(db, "INSERT INTO pairs VALUES ('alice', ?, ?, ?)");
+        for (const auto &[d_username, secret] : {std::pair{"rfc", RFC_SECRET}, std::pair{"old", OLD_SECRET}}) {
+            insert.bind(1, d_username);
+            insert.bind(2, "app");
+            insert.bind(3, std::string(secret));
+            insert.exec();
+            insert.reset();
+        }
+    }
+
+    void expectSecret(const std::string &d_username, const std::string_view text, const char *what) {
+        const std::optional<PairingSecret> secret = Database::getSecret(d_username, "app");
+        expect(secret && secret->secret == TOTPKey(text.data(), text.size()), what);
+        expect(secret && secret->params == DEFAULT_TOTP_PARAMS, "old pairing didn't get the default parameters");
+    }
+}
+
+int main() {
+    const std::filesystem::path dbs = std::filesystem::path(__FILE__).parent_path() / "dbs";
+    const std::filesystem::path path = dbs / (std::string(SERVER_TYPE) + ".db");
+    std::filesystem::create_directories(dbs);
+    std::filesystem::remove(path);
+    createOldDatabase(path);
+
+    Database::init(std::string(SERVER_TYPE));
+    expectSecret("rfc", RFC_SECRET, "RFC secret not re-encoded to its text");
+    expectSecret("old", OLD_SECRET, "old secret not re-encoded to its text");
+    if (const std::optional<PairingSecret> secret = Database::getSecret("rfc", "app"))
+        expect(TOTPGenerator::generateCode(secret->secret, secret->params, 1) == RFC_CODE, "migrated key gives another code");
+
+    // user_version marks the table as migrated, a restart must not encode the keys twice
+    Database::init(std::string(SERVER_TYPE));
+    expectSecret("rfc", RFC_SECRET, "secret re-encoded on the second start");
+    expectSecret("old", OLD_SECRET, "secret re-encoded on the second start");
+
+    // new pairings store their raw key and read it back as is
+    const PairingSecret fresh{TOTPKey::generate(), DEFAULT_TOTP_PARAMS};
+    expect(Database::pairUser("alice", "fresh", "app", fresh), "new pairing not stored");
+    const std::optional<PairingSecret> stored = Database::getSecret("fresh", "app");
+    expect(stored && stored->secret == fresh.secret, "new pairing's key changed");
+
+    std::filesystem::remove(path);
+    return TestCheck::result("MigrateSecrets");
+}
@@ -0,0 +1,70 @@
+#include "UsernameFilter.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace {
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t seedFromDevice() {
+        std::random_device device;
+        return static_cast<uint64_t>(device()) << 32 | device();
+    }
+
+    constexpr uint8_t SATURATED = std::numeric_limits<uint8_t>::max();
+}
+
+UsernameFilter::UsernameFilter() : m_seed(seedFromDevice()) {
+    reset(MIN_CAPACITY);
+}
+
+void UsernameFilter::reset(const size_t capacity) {
+    m_capacity = std::max(capacity, MIN_CAPACITY);
+    m_counters.assign(m_capacity * COUNTERS_PER_NAME, 0);
+    m_names = 0;
+}
+
+template<typename F>
+void UsernameFilter::m_forEachCounter(const std::string_view username, F &&f) const {
+    // FNV-1a started from the seed, then mixed so that every bit feeds both halves
+    uint64_t hash = 0xcbf29ce484222325ULL ^ m_seed;
+    for (const char c : username) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    const uint64_t h1 = mix(hash);
+    const uint64_t h2 = mix(h1) | 1;
+    for (size_t i = 0; i < HASHES; ++i)
+        if (!f((h1 + i * h2) % m_counters.size())) return;
+}
+
+void UsernameFilter::add(const std::string_view username) {
+    m_forEachCounter(username, [this](const size_t i) {
+        if (m_counters[i] != SATURATED) m_counters[i]++;
+        return true;
+    });
+    m_names++;
+}
+
+void UsernameFilter::remove(const std::string_view username) {
+    m_forEachCounter(username, [this](const size_t i) {
+        if (m_counters[i] != SATURATED && m_counters[i] > 0) m_counters[i]--;
+        return true;
+    });
+    if (m_names > 0) m_names--;
+}
+
+bool UsernameFilter::mayContain(const std::string_view username) const {
+    bool found = true;
+    m_forEachCounter(username, [this, &found](const size_t i) {
+        found = m_counters[i] != 0;
+        return found;
+    });
+    return found;
+}
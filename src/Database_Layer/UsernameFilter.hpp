@@ -0,0 +1,45 @@
+#ifndef MY2FA_USERNAMEFILTER_HPP
+#define MY2FA_USERNAMEFILTER_HPP
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Counting Bloom filter over the usernames of the users table, so a login for a name that
+// was never registered is turned away without a query. False positives only cost the query;
+// counters make removal possible, a saturated one is never decremented again.
+class UsernameFilter {
+public:
+    static constexpr size_t HASHES = 7;
+    // with 7 hashes about 1% false positives while the filter is within capacity
+    static constexpr size_t COUNTERS_PER_NAME = 10;
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    UsernameFilter();
+
+    // drops every name and sizes the filter for at least capacity of them
+    void reset(size_t capacity);
+    void add(std::string_view username);
+    // only for names that were added, anything else corrupts the counts
+    void remove(std::string_view username);
+    [[nodiscard]] bool mayContain(std::string_view username) const;
+    // more names than it was sized for, the owner should rebuild it larger
+    [[nodiscard]] bool isFull() const { return m_names > m_capacity; }
+    [[nodiscard]] size_t size() const { return m_names; }
+    [[nodiscard]] size_t capacity() const { return m_capacity; }
+    [[nodiscard]] size_t bytes() const { return m_counters.size(); }
+
+private:
+    std::vector<uint8_t> m_counters;
+    size_t m_names = 0;
+    size_t m_capacity = 0;
+    uint64_t m_seed; // per process, so colliding names can't be precomputed
+
+    // the HASHES counter positions are h1 + i * h2, from one seeded 64 bit hash
+    template<typename F>
+    void m_forEachCounter(std::string_view username, F &&f) const;
+};
+
+#endif //MY2FA_USERNAMEFILTER_HPP
@@ -0,0 +1,57 @@
+#include <string>
+#include "UsernameFilter.hpp"
+#include "Test_Layer/TestCheck.hpp"
+
+namespace {
+    using TestCheck::expect;
+
+    std::string name(const size_t i) { return "user" + std::to_string(i); }
+}
+
+int main() {
+    UsernameFilter filter;
+    filter.reset(1000);
+    expect(filter.capacity() == UsernameFilter::MIN_CAPACITY, "capacity not raised to the minimum");
+    expect(!filter.mayContain("alice"), "empty filter claims a name");
+
+    // added names are always found, removed ones are gone unless another name shares all counters
+    for (size_t i = 0; i < 1000; ++i) filter.add(name(i));
+    expect(filter.size() == 1000 && !filter.isFull(), "wrong name count");
+    bool all_found = true;
+    for (size_t i = 0; i < 1000; ++i) all_found &= filter.mayContain(name(i));
+    expect(all_found, "an added name is missing");
+
+    // within capacity the false positives stay around the sized 1%
+    size_t false_positives = 0;
+    for (size_t i = 1000; i < 11000; ++i) false_positives += filter.mayContain(name(i));
+    expect(false_positives < 300, "too many false positives within capacity");
+
+    for (size_t i = 0; i < 500; ++i) filter.remove(name(i));
+    expect(filter.size() == 500, "removals not counted");
+    all_found = true;
+    for (size_t i = 500; i < 1000; ++i) all_found &= filter.mayContain(name(i));
+    expect(all_found, "removing a name dropped another one");
+    size_t still_there = 0;
+    for (size_t i = 0; i < 500; ++i) still_there += filter.mayContain(name(i));
+    expect(still_there < 50, "removed names still found");
+
+    // a saturated counter can't know how many names it holds, so it is never decremented:
+    // the name stays (at worst a false positive) instead of taking the others down with it
+    filter.reset(0);
+    for (int i = 0; i < 300; ++i) filter.add("bob");
+    filter.add("carol");
+    for (int i = 0; i < 300; ++i) filter.remove("bob");
+    expect(filter.mayContain("bob"), "saturated counters were decremented");
+    expect(filter.mayContain("carol"), "another name lost next to a saturated one");
+    expect(filter.size() == 1, "wrong name count after saturation");
+
+    filter.remove("carol");
+    expect(filter.size() == 0, "name count not back to zero");
+
+    // past its capacity the owner is told to rebuild
+    filter.reset(0);
+    for (size_t i = 0; i <= filter.capacity(); ++i) filter.add(name(i));
+    expect(filter.isFull(), "filter over capacity not reported full");
+
+    return TestCheck::result("UsernameFilter");
+}
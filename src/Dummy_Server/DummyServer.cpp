@@ -5,6 +5,7 @@
 
 #include "Auth_Layer/AuthManager.hpp"
 #include "Command_Layer/Code_Login/CodeLoginCommands.hpp"
+#include "Command_Layer/CommandArena.hpp"
 #include "Command_Layer/CommandFactory.hpp"
 #include "Command_Layer/Context.hpp"
 #include "Command_Layer/Notification_Login/NotificationLoginCommands.hpp"
@@ -35,6 +36,7 @@ void handleUserInput(Context &ctx, const std::string &input) {
 
     if (args[0] == "help") {
         std::cout << "  clients                                     : List all active clients.\n"
+                  << "  arena                                       : Command arena allocation stats\n"
                   << "  reconnect                                   : Reconnect to AS\n"
                   << "  err <code> <msg>                            : Send Error to AS\n"
                   << "  req_notif_server <uuid> <appid>             : Send Notification Request to AS\n"
@@ -135,6 +137,8 @@ int main(int argc, char *argv[]) {
     ServerConnectionHandler ds_handler(DS_PORT);
     SessionManager session_manager;
     AuthManager auth_manager("ds_" + app_id);
+    CommandArena arena;
+    ds_handler.setCommandArena(&arena);
 
     Context ctx{session_manager, &auth_manager, ds_handler, nullptr, app_id};
 
@@ -172,6 +176,7 @@ int main(int argc, char *argv[]) {
     bool run = true;
     while (run) {
         ds_handler.update();
+        auth_manager.update();
         if (as_connected && as_handler) {
             if (!as_handler->isRunning()) {
                 std::cerr << "[DS Error] Auth Server disconnected.\n";
@@ -197,6 +202,13 @@ int main(int argc, char *argv[]) {
                     std::cout << "\033[2J\033[H" << std::flush;
                     continue;
                 }
+                if (split(input)[0] == "arena") {
+                    const auto stats = arena.getStats();
+                    std::cout << "[DS Log] Commands: " << stats.dispatches
+                              << " | Arena bytes: " << stats.arena_bytes
+                              << " | Heap fallback bytes: " << stats.heap_bytes << "\n";
+                    continue;
+                }
                 handleUserInput(ctx, input);
             }
         }
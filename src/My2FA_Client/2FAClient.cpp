@@ -78,6 +78,7 @@ void runCodeState(Context &ctx, ClientConnectionHandler &handler) {
         }
 
         handler.update();
+        CodeResponseCommand::promoteNextCodes(ctx);
 
         if (last_height > 0) {
             std::cout << "\033[" << last_height << "A";
@@ -120,6 +121,7 @@ void handleUserInput(Context &ctx, ClientConnectionHandler *handler, const std::
                       << "  register <user> <password>    : Register a new user on AuthServer (e.g. register;user;pass)\n"
                       << "  register                      : Register new user (e.g. register;user;pass)\n"
                       << "  code                          : Request 2FA Code (e.g. code)\n"
+                      << "  filter <appid> ...            : Only push codes of these apps, none to show all (e.g. filter;101;102)\n"
                       << "  accept <appid>                : Accept Notification (e.g. accept;101)\n"
                       << "  refuse <appid>                : Refuse Notification (e.g. refuse;101)\n"
                       << "  exit                          : Quit\n";
@@ -161,6 +163,10 @@ void handleUserInput(Context &ctx, ClientConnectionHandler *handler, const std::
             std::cerr << "[AC Error] Code must be an integer.\n";
             return;
         }
+    } else if (args[0] == "filter") {
+        // kept so a login on a fresh AS session can restore it
+        ctx.codeFilter.assign(args.begin() + 1, args.end());
+        command = std::make_unique<SubscribeCodesCommand>(ctx.codeFilter);
     } else if (args[0] == "login") {
         if (args.size() != 3) {
             std::cerr << "[AC Error] Incorrect format: login;<user>;<pass>\n ";
@@ -170,6 +176,9 @@ void handleUserInput(Context &ctx, ClientConnectionHandler *handler, const std::
     } else if (args[0] == "logout") {
         ctx.username = "";
         ctx.isLogged = false;
+        ctx.resumeToken = "";
+        ctx.codes.clear();
+        ctx.codeFilter.clear();
         command = std::make_unique<LogoutRequestCommand>();
     } else if (args[0] == "register") {
         if (args.size() != 3) {
@@ -236,6 +245,14 @@ int main(int argc, char *argv[]) {
             });
             ctx.client_handler = handler.get();
             ctx.isConnected = true;
+            // reattach to the previous session, LOGIN_RESP flips isLogged back on success
+            if (ctx.isLogged && !ctx.resumeToken.empty()) {
+                ctx.isLogged = false;
+                handler->sendCommand(std::make_unique<CredentialRequestCommand>(
+                    CommandType::RESUME_REQ, ctx.username, ctx.resumeToken));
+                ctx.resumeToken = "";
+                std::cout << "[AC Log] Resuming session for " << ctx.username << "\n";
+            }
         } catch (...) {
             ctx.isConnected = false;
             std::cerr << "[AC Error] Connection to AS Failed." << "\n";
@@ -4,6 +4,7 @@
 #include <sys/types.h>
 #include <sys/time.h>
 
+#include "Command_Layer/CommandArena.hpp"
 #include "Command_Layer/CommandFactory.hpp"
 #include "Command_Layer/Notification_Login/NotificationLoginCommands.hpp"
 #include "Command_Layer/Code_Login/CodeLoginCommands.hpp"
@@ -11,6 +12,7 @@
 #include "Session_Manager/SessionManager.hpp"
 #include "Auth_Layer/AuthManager.hpp"
 #include "Command_Layer/Context.hpp"
+#include "Command_Layer/FlowManager.hpp"
 #include "TOTP_Layer/TOTPManager.hpp"
 
 void handleCommand(const std::unique_ptr<Command> &command, const int client_fd, Context &ctx) {
@@ -36,6 +38,12 @@ void handleUserInput(ServerConnectionHandler &handler, const std::string &input,
                   << "  help       : Shows this menu\n"
                   << "  clients    : List all active client file descriptors.\n"
                   << "  db         : Prints all data in DB.\n"
+                  << "  arena      : Prints command arena allocation stats.\n"
+                  << "  codes      : Prints TOTP code cache and verification counters.\n"
+                  << "  latency    : Prints code push latency and cycle histograms.\n"
+                  << "  skew <n>   : Accept codes up to n steps away from now.\n"
+                  << "  pace <s>   : Spread code pushes over the last s seconds of a window.\n"
+                  << "  kdf [n]    : Prints password hashing stats, or hashes new passwords with n iterations.\n"
                   << "  clear      : Clears screen (aliases: cl, cls, clr)"
                   << "  exit       : Shut down the server.\n";
         return;
@@ -67,11 +75,15 @@ int main(int argc, char *argv[]) {
 
     signal(SIGPIPE, SIG_IGN); // avoid crashes from sending
 
-    AuthManager auth_manager("as");
     SessionManager session_manager;
+    // after session_manager, so login flows still parked in the hash pool free their sessions first
+    AuthManager auth_manager("as");
     ServerConnectionHandler handler(PORT);
+    FlowManager flow_manager;
+    CommandArena arena;
+    handler.setCommandArena(&arena);
 
-    Context ctx{session_manager, &auth_manager, handler, nullptr};
+    Context ctx{session_manager, &auth_manager, handler, nullptr, &flow_manager};
 
     TOTPManager totp_manager(ctx);
     ctx.totp_manager = &totp_manager;
@@ -94,6 +106,9 @@ int main(int argc, char *argv[]) {
     bool run = true;
     while (run) {
         handler.update();
+        flow_manager.update();
+        auth_manager.update();
+        session_manager.expireDetached();
 
         if (checkConsoleInput()) {
             std::string input;
@@ -112,6 +127,79 @@ int main(int argc, char *argv[]) {
                     ctx.auth_manager->show();
                     continue;
                 }
+                if (split(input)[0] == "arena") {
+                    const auto stats = arena.getStats();
+                    std::cout << "[AS Log] Commands: " << stats.dispatches
+                              << " | Arena bytes: " << stats.arena_bytes
+                              << " | Heap fallback bytes: " << stats.heap_bytes << "\n";
+                    continue;
+                }
+                if (split(input)[0] == "codes") {
+                    const auto stats = totp_manager.getCodeCacheStats();
+                    std::cout << "[AS Log] Code cache hits: " << stats.hits
+                              << " | Misses: " << stats.misses
+                              << " | Cached codes: " << stats.entries << "\n";
+                    const auto verify = totp_manager.getVerifyStats();
+                    std::cout << "[AS Log] Verifications: " << verify.verifications
+                              << " | Steps tried: " << verify.steps_tried
+                              << " | Learned drifts: " << verify.learned_drifts << "\n";
+                    const auto replay = totp_manager.getReplayStats();
+                    std::cout << "[AS Log] Codes consumed: " << replay.accepted
+                              << " | Replays rejected: " << replay.replays
+                              << " | Rejected while full: " << replay.rejected_full
+                              << " | Replay cache bytes: " << replay.reserved_bytes << "\n";
+                    const auto push = totp_manager.getPushStats();
+                    std::cout << "[AS Log] Push rounds: " << push.rounds
+                              << " | Precompute workers: " << push.workers
+                              << " | Last precompute: " << push.last_precompute.count() << "us"
+                              << " | Boundary to last push: " << push.last_delay.count() << "ms"
+                              << " (max " << push.max_delay.count() << "ms)\n";
+                    std::cout << "[AS Log] Pushed frames: " << push.frames << " (" << push.frame_bytes << " bytes)\n";
+                    continue;
+                }
+                if (split(input)[0] == "latency") {
+                    const auto metrics = totp_manager.getPushMetrics();
+                    std::cout << "[AS Log] Boundary to enqueue: " << metrics.enqueue_ms.toString("ms") << "\n"
+                              << "[AS Log] Boundary to flush: " << metrics.flush_ms.toString("ms") << "\n"
+                              << "[AS Log] Sessions per cycle: " << metrics.sessions.toString("") << "\n"
+                              << "[AS Log] Cycle duration: " << metrics.cycle_ms.toString("ms") << "\n"
+                              << "[AS Log] Frames flushed after their window: "
+                              << metrics.flush_ms.countAbove(PushMetrics::WINDOW_MS) << "\n";
+                    continue;
+                }
+                if (split(input)[0] == "kdf") {
+                    if (split(input).size() > 1) {
+                        try {
+                            auth_manager.setKdfIterations(std::stoul(split(input)[1]));
+                        } catch (std::exception &e) {
+                            std::cerr << "[AS Error] Usage: kdf <iterations> | " << e.what() << "\n";
+                        }
+                        continue;
+                    }
+                    const auto hashing = auth_manager.getHashStats();
+                    std::cout << "[AS Log] PBKDF2 iterations: " << auth_manager.getKdfIterations()
+                              << " | Hash threads: " << hashing.threads
+                              << " | Queued: " << hashing.queued << "/" << HashPool::MAX_QUEUED
+                              << " | Completed: " << hashing.completed
+                              << " | Rejected while full: " << hashing.rejected << "\n";
+                    continue;
+                }
+                if (split(input)[0] == "pace") {
+                    try {
+                        totp_manager.setPaceSeconds(std::stoi(split(input).at(1)));
+                    } catch (std::exception &e) {
+                        std::cerr << "[AS Error] Usage: pace <seconds> | " << e.what() << "\n";
+                    }
+                    continue;
+                }
+                if (split(input)[0] == "skew") {
+                    try {
+                        totp_manager.setSkewSteps(std::stoi(split(input).at(1)));
+                    } catch (std::exception &e) {
+                        std::cerr << "[AS Error] Usage: skew <steps> | " << e.what() << "\n";
+                    }
+                    continue;
+                }
                 handleUserInput(handler, input, session_manager);
             }
         }
@@ -0,0 +1,60 @@
+#include "EpochReclaimer.hpp"
+#include <algorithm>
+
+namespace {
+    // gives the reader slot back when its thread exits
+    struct ThreadSlot {
+        int index = -1;
+        int depth = 0;
+        std::atomic<bool> *used = nullptr;
+
+        ~ThreadSlot() {
+            if (used) used->store(false, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadSlot t_slot;
+}
+
+std::array<EpochReaders::Slot, EpochReaders::MAX_READERS> EpochReaders::s_slots;
+std::atomic<uint64_t> EpochReaders::s_epoch{1};
+
+int EpochReaders::m_threadSlot() {
+    if (t_slot.index >= 0) return t_slot.index;
+    for (size_t i = 0; i < MAX_READERS; ++i) {
+        bool expected = false;
+        if (s_slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            t_slot.index = static_cast<int>(i);
+            t_slot.used = &s_slots[i].used;
+            return t_slot.index;
+        }
+    }
+    return -1;
+}
+
+EpochReaders::ReadGuard::ReadGuard() : m_slot(m_threadSlot()) {
+    if (m_slot < 0) return;
+    if (t_slot.depth++ == 0) {
+        // seq_cst so the announcement is ordered before the pointer loads that follow
+        s_slots[m_slot].epoch.store(s_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+EpochReaders::ReadGuard::~ReadGuard() {
+    if (m_slot < 0) return;
+    if (--t_slot.depth == 0)
+        s_slots[m_slot].epoch.store(0, std::memory_order_release);
+}
+
+uint64_t EpochReaders::advance() {
+    return s_epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+uint64_t EpochReaders::oldestActive() {
+    uint64_t oldest = UINT64_MAX;
+    for (const Slot &slot: s_slots) {
+        if (const uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst); epoch != 0)
+            oldest = std::min(oldest, epoch);
+    }
+    return oldest;
+}
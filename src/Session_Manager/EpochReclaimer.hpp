@@ -0,0 +1,89 @@
+#ifndef MY2FA_EPOCHRECLAIMER_HPP
+#define MY2FA_EPOCHRECLAIMER_HPP
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+// Epoch based reclamation for immutable objects published through atomic pointers.
+// Readers announce the epoch they started in, writers swap the pointer and retire the old
+// object, which is only freed once every reader that could still see it has left.
+class EpochReaders {
+public:
+    static constexpr size_t MAX_READERS = 64;
+
+    // RAII read side critical section, cheap and nestable
+    class ReadGuard {
+    public:
+        ReadGuard();
+        ~ReadGuard();
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        // false when every reader slot is taken, the caller then has to fall back to locking
+        [[nodiscard]] bool active() const { return m_slot >= 0; }
+
+    private:
+        int m_slot;
+    };
+
+    // bumps the global epoch and returns the epoch an object retired now belongs to
+    static uint64_t advance();
+    // smallest epoch a reader is still in, UINT64_MAX if nobody is reading
+    [[nodiscard]] static uint64_t oldestActive();
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0}; // 0 while the owning thread is not reading
+        std::atomic<bool> used{false};
+    };
+
+    static int m_threadSlot();
+
+    static std::array<Slot, MAX_READERS> s_slots;
+    static std::atomic<uint64_t> s_epoch;
+};
+
+template<typename T>
+class EpochReclaimer {
+public:
+    static constexpr size_t COLLECT_THRESHOLD = 32;
+
+    EpochReclaimer() = default;
+    ~EpochReclaimer() {
+        // only destroyed once no thread reads anymore
+        for (const auto &ptr: m_retired | std::views::values)
+            delete ptr;
+    }
+
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+    // ptr has to be unreachable for new readers already (swapped out of its atomic)
+    void retire(const T *ptr) {
+        if (!ptr) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retired.emplace_back(EpochReaders::advance(), ptr);
+        if (m_retired.size() >= COLLECT_THRESHOLD) m_collect();
+    }
+
+private:
+    std::vector<std::pair<uint64_t, const T *>> m_retired;
+    std::mutex m_mutex;
+
+    void m_collect() {
+        const uint64_t oldest = EpochReaders::oldestActive();
+        std::erase_if(m_retired, [oldest](const auto &retired) {
+            if (retired.first >= oldest) return false; // a reader may still hold it
+            delete retired.second;
+            return true;
+        });
+    }
+};
+
+#endif //MY2FA_EPOCHRECLAIMER_HPP
@@ -0,0 +1,51 @@
+#include "Interner.hpp"
+#include <mutex>
+
+Interner::Interner() {
+    m_strings.emplace_back(); // NO_ID
+    m_ids.emplace(std::string_view(m_strings.front()), NO_ID);
+}
+
+Interner &Interner::global() {
+    static Interner interner;
+    return interner;
+}
+
+InternID Interner::intern(const std::string_view text) {
+    {
+        std::shared_lock lock(m_mutex);
+        if (const auto it = m_ids.find(text); it != m_ids.end()) return it->second;
+    }
+    std::unique_lock lock(m_mutex);
+    if (const auto it = m_ids.find(text); it != m_ids.end()) return it->second; // raced with another writer
+    const auto id = static_cast<InternID>(m_strings.size());
+    const std::string &stored = m_strings.emplace_back(text);
+    m_ids.emplace(std::string_view(stored), id);
+    if (stored.capacity() >= sizeof(std::string)) m_text_bytes += stored.capacity() + 1; // else inline (SSO)
+    return id;
+}
+
+InternID Interner::find(const std::string_view text) const {
+    std::shared_lock lock(m_mutex);
+    if (const auto it = m_ids.find(text); it != m_ids.end()) return it->second;
+    return NO_ID;
+}
+
+std::string_view Interner::view(const InternID id) const {
+    std::shared_lock lock(m_mutex);
+    if (id >= m_strings.size()) return {};
+    return m_strings[id];
+}
+
+size_t Interner::size() const {
+    std::shared_lock lock(m_mutex);
+    return m_strings.size() - 1;
+}
+
+// approximate: node based map overhead is estimated per entry
+size_t Interner::reservedBytes() const {
+    std::shared_lock lock(m_mutex);
+    return m_text_bytes + m_strings.size() * sizeof(std::string)
+        + m_ids.bucket_count() * sizeof(void *)
+        + m_ids.size() * (sizeof(std::string_view) + sizeof(InternID) + 2 * sizeof(void *));
+}
@@ -0,0 +1,42 @@
+#ifndef MY2FA_INTERNER_HPP
+#define MY2FA_INTERNER_HPP
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// dense id standing in for a username or app_id, 0 is the empty string
+using InternID = uint32_t;
+constexpr InternID NO_ID = 0;
+
+// Maps usernames and app_ids to dense ids shared by the Session, Auth and TOTP layers.
+// Strings are only turned back into text at the protocol boundary through view().
+// Entries are never removed, so views stay valid for the lifetime of the process.
+class Interner {
+public:
+    Interner();
+    Interner(const Interner &) = delete;
+    Interner &operator=(const Interner &) = delete;
+
+    static Interner &global();
+
+    // returns the existing id or adds a new one
+    InternID intern(std::string_view text);
+    // lookup only, NO_ID if text was never interned, so unknown names don't grow the table
+    [[nodiscard]] InternID find(std::string_view text) const;
+    [[nodiscard]] std::string_view view(InternID id) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t reservedBytes() const;
+
+private:
+    std::deque<std::string> m_strings; // indexed by id, deque keeps the addresses stable
+    std::unordered_map<std::string_view, InternID> m_ids;
+    size_t m_text_bytes = 0;
+    mutable std::shared_mutex m_mutex;
+};
+
+#endif //MY2FA_INTERNER_HPP
@@ -0,0 +1,36 @@
+#include "Pairings.hpp"
+#include <algorithm>
+#include <atomic>
+
+Pairings::Pairings(std::vector<Entry> entries, const uint64_t version)
+    : m_entries(std::move(entries)), m_version(version) {}
+
+PairingsPtr Pairings::create(std::vector<Entry> entries) {
+    static std::atomic<uint64_t> next_version{1};
+    std::ranges::sort(entries, {}, &Entry::first);
+    // make_shared can't reach the private constructor
+    return PairingsPtr(new Pairings(std::move(entries), next_version.fetch_add(1, std::memory_order_relaxed)));
+}
+
+PairingsPtr Pairings::fromMap(const std::map<std::string, PairingSecret> &pairings) {
+    std::vector<Entry> entries;
+    entries.reserve(pairings.size());
+    for (const auto &[app_id, secret]: pairings)
+        entries.emplace_back(Interner::global().intern(app_id), secret);
+    return create(std::move(entries));
+}
+
+PairingsPtr Pairings::with(const InternID app_id, PairingSecret secret) const {
+    std::vector<Entry> entries = m_entries;
+    const auto it = std::ranges::lower_bound(entries, app_id, {}, &Entry::first);
+    if (it != entries.end() && it->first == app_id) it->second = std::move(secret);
+    else entries.emplace(it, app_id, std::move(secret));
+    return create(std::move(entries));
+}
+
+PairingsPtr Pairings::only(const std::span<const InternID> app_ids) const {
+    std::vector<Entry> entries;
+    for (const Entry &entry : m_entries)
+        if (std::ranges::binary_search(app_ids, entry.first)) entries.push_back(entry);
+    return create(std::move(entries));
+}
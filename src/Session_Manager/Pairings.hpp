@@ -0,0 +1,44 @@
+#ifndef MY2FA_PAIRINGS_HPP
+#define MY2FA_PAIRINGS_HPP
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Interner.hpp"
+#include "TOTP_Layer/TOTPParams.hpp"
+
+class Pairings;
+using PairingsPtr = std::shared_ptr<const Pairings>;
+
+// Immutable app_id -> secret (and its TOTP parameters) table of one user, flat and sorted by interned app_id.
+// Every session of the user shares the same snapshot; a change builds a new one and swaps it in,
+// so readers like the TOTP thread never see it mid-update.
+class Pairings {
+public:
+    using Entry = std::pair<InternID, PairingSecret>;
+
+    [[nodiscard]] static PairingsPtr create(std::vector<Entry> entries);
+    [[nodiscard]] static PairingsPtr fromMap(const std::map<std::string, PairingSecret> &pairings);
+    // copy of this snapshot with app_id added or replaced
+    [[nodiscard]] PairingsPtr with(InternID app_id, PairingSecret secret) const;
+    // copy holding only the entries whose app_id is in app_ids, which has to be sorted
+    [[nodiscard]] PairingsPtr only(std::span<const InternID> app_ids) const;
+
+    [[nodiscard]] const std::vector<Entry> &entries() const { return m_entries; }
+    [[nodiscard]] bool empty() const { return m_entries.empty(); }
+    // unique per snapshot, lets cached data built from one tell when it is stale
+    [[nodiscard]] uint64_t version() const { return m_version; }
+
+private:
+    Pairings(std::vector<Entry> entries, uint64_t version);
+
+    const std::vector<Entry> m_entries;
+    const uint64_t m_version;
+};
+
+#endif //MY2FA_PAIRINGS_HPP
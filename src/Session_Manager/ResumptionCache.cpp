@@ -0,0 +1,81 @@
+#include "ResumptionCache.hpp"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+void ResumptionCache::detach(const std::string &token, DetachedSession session) {
+    if (token.empty()) return;
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_expire(now);
+    // full: evict the ones closest to expiring first
+    while (!m_order.empty() && (m_entries.size() >= MAX_DETACHED || m_order.size() >= 2 * MAX_DETACHED)) {
+        const auto &[expires, old_token] = m_order.front();
+        if (const auto it = m_entries.find(old_token); it != m_entries.end() && it->second.expires == expires)
+            m_erase(it);
+        m_order.pop_front();
+    }
+    if (const auto it = m_entries.find(token); it != m_entries.end()) m_erase(it);
+    const auto expires = now + TTL;
+    const InternID identity = session.identity;
+    m_entries.emplace(token, Entry{std::move(session), expires});
+    m_order.emplace_back(expires, token);
+    if (m_tokens.size() <= identity) m_tokens.resize(identity + 1);
+    m_tokens[identity].push_back(token);
+}
+
+std::optional<DetachedSession> ResumptionCache::take(const std::string &token, const InternID identity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_entries.find(token);
+    if (it == m_entries.end()) return std::nullopt;
+    if (it->second.expires <= Clock::now() || it->second.session.identity != identity) {
+        // a wrong guess burns the token as well
+        m_erase(it);
+        return std::nullopt;
+    }
+    DetachedSession session = std::move(it->second.session);
+    m_erase(it);
+    return session;
+}
+
+void ResumptionCache::drop(const InternID identity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (identity >= m_tokens.size()) return;
+    for (const std::string &token : m_tokens[identity]) m_entries.erase(token);
+    m_tokens[identity].clear();
+}
+
+size_t ResumptionCache::expire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t removed = m_expire(Clock::now());
+    if (removed > 0) std::cout << "[SM Log] Expired " << removed << " detached sessions\n";
+    return removed;
+}
+
+size_t ResumptionCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+size_t ResumptionCache::m_expire(const Clock::time_point now) {
+    size_t removed = 0;
+    while (!m_order.empty() && m_order.front().first <= now) {
+        const auto &[expires, token] = m_order.front();
+        if (const auto it = m_entries.find(token); it != m_entries.end() && it->second.expires == expires) {
+            m_erase(it);
+            removed++;
+        }
+        m_order.pop_front();
+    }
+    return removed;
+}
+
+void ResumptionCache::m_erase(const std::unordered_map<std::string, Entry>::iterator it) {
+    // a user only has a handful of detached devices, a linear pass over them is enough
+    std::vector<std::string> &tokens = m_tokens[it->second.session.identity];
+    if (const auto token = std::ranges::find(tokens, it->first); token != tokens.end()) {
+        std::swap(*token, tokens.back());
+        tokens.pop_back();
+    }
+    m_entries.erase(it);
+}
@@ -0,0 +1,58 @@
+#ifndef MY2FA_RESUMPTIONCACHE_HPP
+#define MY2FA_RESUMPTIONCACHE_HPP
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Interner.hpp"
+#include "Pairings.hpp"
+
+// what a logged in AuthClient leaves behind when its connection drops
+struct DetachedSession {
+    InternID identity = NO_ID;
+    PairingsPtr pairings;
+};
+
+// Detached sessions keyed by their one-shot resumption token.
+// Bounded in size, entries expire TTL after they were detached; all entries share the
+// same TTL so insertion order is also expiry order and a deque is enough to track it.
+class ResumptionCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds TTL{120};
+    static constexpr size_t MAX_DETACHED = 4096;
+
+    void detach(const std::string &token, DetachedSession session);
+    // removes and returns the entry if the token is known, unexpired and belongs to identity
+    [[nodiscard]] std::optional<DetachedSession> take(const std::string &token, InternID identity);
+    // drops every cached session of identity, used when its pairings change
+    void drop(InternID identity);
+    // frees expired entries, returns how many were removed
+    size_t expire();
+    [[nodiscard]] size_t size() const;
+
+private:
+    struct Entry {
+        DetachedSession session;
+        Clock::time_point expires;
+    };
+
+    std::unordered_map<std::string, Entry> m_entries;
+    std::deque<std::pair<Clock::time_point, std::string>> m_order; // may hold tokens already taken
+    // identity -> its tokens in m_entries, indexed directly by InternID so drop() needs no scan
+    std::vector<std::vector<std::string>> m_tokens;
+    mutable std::mutex m_mutex;
+
+    size_t m_expire(Clock::time_point now);
+    // removes the entry and its index slot, every erase from m_entries goes through here
+    void m_erase(std::unordered_map<std::string, Entry>::iterator it);
+};
+
+#endif //MY2FA_RESUMPTIONCACHE_HPP
@@ -1,144 +1,409 @@
 #include "SessionManager.hpp"
 #include <SQLiteCpp/Database.h>
+#include <algorithm>
 #include <iostream>
 #include <memory>
-#include <ranges>
+
+SessionManager::Shard &SessionManager::m_shard(const int id) {
+    return m_shards[static_cast<unsigned>(id) % SHARD_COUNT];
+}
+
+const SessionManager::Shard &SessionManager::m_shard(const int id) const {
+    return m_shards[static_cast<unsigned>(id) % SHARD_COUNT];
+}
+
+void SessionManager::m_setIdentity(Session &session, const InternID identity) {
+    if (session.identity == identity) return;
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    if (session.identity != NO_ID) m_indexRemove(session.identity, session.id);
+    if (identity != NO_ID) {
+        if (identity >= m_identity_index.size()) m_identity_index.resize(identity + 1);
+        m_identity_index[identity].push_back(session.id);
+    }
+    session.identity = identity;
+}
+
+void SessionManager::m_indexRemove(const InternID identity, const int id) {
+    if (identity >= m_identity_index.size()) return;
+    std::vector<int> &ids = m_identity_index[identity];
+    std::erase(ids, id);
+    if (ids.empty()) ids.shrink_to_fit();
+}
+
+void SessionManager::m_storePairings(AC_Data &ac_data, PairingsPtr pairings) {
+    PairingsPtr shown = pairings && !ac_data.app_filter.empty() ? pairings->only(ac_data.app_filter) : pairings;
+    ac_data.pairings.store(std::move(pairings));
+    ac_data.code_pairings.store(std::move(shown));
+}
+
+void SessionManager::m_registerPairings(const InternID identity, const PairingsPtr &pairings) {
+    if (identity == NO_ID || !pairings) return;
+    std::lock_guard<std::mutex> lock(m_pairings_mutex);
+    if (identity >= m_user_pairings.size()) m_user_pairings.resize(identity + 1);
+    m_user_pairings[identity] = pairings;
+}
+
+void SessionManager::m_setUserPairings(const InternID identity, const PairingsPtr &pairings) {
+    m_registerPairings(identity, pairings);
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_index_mutex);
+        if (identity < m_identity_index.size()) ids = m_identity_index[identity];
+    }
+    // one shard at a time, the snapshot itself is swapped atomically
+    for (const int id: ids) {
+        Shard &shard = m_shard(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (const auto it = shard.sessions.find(id); it != shard.sessions.end() && it->second->identity == identity)
+            m_storePairings(m_acData(*it->second), pairings);
+    }
+    // detached sessions of the user would come back with the old snapshot
+    m_detached.drop(identity);
+}
+
+SessionManager::SessionManager()
+    // one block holds the shared_ptr control block together with the session
+    : m_pool(sizeof(Session) + 64) {}
+
+AC_Data &SessionManager::m_acData(Session &session) {
+    if (!session.ac_data) session.ac_data = std::make_unique<AC_Data>();
+    return *session.ac_data;
+}
+
+void SessionManager::m_publish(const Session &session) {
+    const int id = session.id;
+    const auto *view = new SessionSnapshot{m_slots.getType(id), std::string(Interner::global().view(session.identity)),
+        m_slots.getFlag(id, SessionSlots::LOGGED), m_slots.getFlag(id, SessionSlots::CODE_STATE)};
+    m_retired_views.retire(m_slots.exchangeView(id, view));
+}
+
+void SessionManager::m_setCodeState(const std::shared_ptr<Session> &session, const bool isInCodeState) {
+    m_slots.setFlag(session->id, SessionSlots::CODE_STATE, isInCodeState);
+    if (!isInCodeState && !session->ac_data) return; // never subscribed
+    AC_Data &ac_data = m_acData(*session);
+
+    std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+    const bool subscribed = ac_data.subscriber_slot != SIZE_MAX;
+    if (isInCodeState == subscribed) return;
+
+    if (isInCodeState) {
+        ac_data.subscriber_slot = m_code_subscribers.size();
+        m_code_subscribers.push_back(session);
+    } else {
+        // swap with the last one so removal stays O(1)
+        const size_t slot = ac_data.subscriber_slot;
+        m_code_subscribers[slot] = std::move(m_code_subscribers.back());
+        m_code_subscribers[slot]->ac_data->subscriber_slot = slot;
+        m_code_subscribers.pop_back();
+        ac_data.subscriber_slot = SIZE_MAX;
+    }
+    m_subscribers_version++;
+}
 
 void SessionManager::addSession(const int id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    // make_shared doesn't work because of the atomic bools which are un-copyable
-    m_sessions[id] = std::shared_ptr<Session>(new Session{
-        id, EntityType::NOT_ASSIGNED, "", true});
+    if (!SessionSlots::fits(id)) {
+        std::cerr << "[SM Error] Session id out of range: " << id << "\n";
+        return;
+    }
+    const auto session = std::allocate_shared<Session>(SlabAllocator<Session>(m_pool), id);
+    m_slots.reset(id);
+
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.sessions[id] = session;
+    m_publish(*session);
     std::cout << "[SM Log] Session added: " << id << "\n";
 }
 
 void SessionManager::removeSession(const int id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end()) {
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        // logged in AuthClients with a token are kept around for a while to resume
+        if (AC_Data *ac_data = it->second->ac_data.get(); ac_data && !ac_data->resume_token.empty()
+                && m_slots.getFlag(id, SessionSlots::LOGGED)) {
+            m_detached.detach(ac_data->resume_token, {it->second->identity, ac_data->pairings.exchange(nullptr)});
+            ac_data->code_pairings.store(nullptr);
+            std::cout << "[SM Log] Session " << id << " detached for resumption\n";
+        }
+        m_setIdentity(*it->second, NO_ID);
+        m_setCodeState(it->second, false);
+        m_retired_views.retire(m_slots.exchangeView(id, nullptr));
         it->second->isValid = false;
         it->second->id = -1;
-        m_sessions.erase(it);
+        shard.sessions.erase(it);
+        m_slots.reset(id);
         std::cout << "[SM Log] Session removed: " << id << "\n";
     }
 }
 
 void SessionManager::handleHandshake(const int id, const EntityType type, const std::string &app_id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (auto it = m_sessions.find(id); it != m_sessions.end()) {
-        if (m_sessions[id]->type == EntityType::NOT_ASSIGNED) {
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        if (m_slots.getType(id) == EntityType::NOT_ASSIGNED) {
             if (type == EntityType::DUMMY_SERVER) {
-                m_sessions[id]->identity = app_id;
+                m_setIdentity(*it->second, Interner::global().intern(app_id));
             }
-            m_sessions[id]->type = type;
+            m_slots.setType(id, type);
+            m_publish(*it->second);
             std::cout << "[SM Log] Handshake successful: " << id << " " << type << "\n";
         }
     }
 }
 
 void SessionManager::displayConnections() {
-    std::lock_guard<std::mutex> lock(m_mutex);
     std::cout << "[SM Log] Active sessions:\n";
     bool found = false;
-    for (auto &[id, session]: m_sessions) {
-        found = true;
-        if (session->type == EntityType::DUMMY_SERVER) {
-            std::cout << "ID: " << id << "\nType: " << stringifyEntityType(session->type)
-                  << "\nIdentity: " << session->identity << "\nisValid: " << session->isValid << "\n\n";
-        }
-        else {
-            std::cout << "ID: " << id << "\nType: " << stringifyEntityType(session->type)
-                  << "\nisLogged: " << session->ac_data->isLogged
-                  << "\nIdentity: " << session->identity<< "\nisValid: " << session->isValid << "\nisInCodeState: "
-                << session->ac_data->isInCodeState << "\n\n";
+    for (const Shard &shard: m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto &[id, session]: shard.sessions) {
+            found = true;
+            const EntityType type = m_slots.getType(id);
+            if (type == EntityType::DUMMY_SERVER) {
+                std::cout << "ID: " << id << "\nType: " << stringifyEntityType(type)
+                      << "\nIdentity: " << Interner::global().view(session->identity) << "\nisValid: " << session->isValid << "\n\n";
+            }
+            else {
+                std::cout << "ID: " << id << "\nType: " << stringifyEntityType(type)
+                      << "\nisLogged: " << m_slots.getFlag(id, SessionSlots::LOGGED)
+                      << "\nIdentity: " << Interner::global().view(session->identity) << "\nisValid: " << session->isValid << "\nisInCodeState: "
+                    << m_slots.getFlag(id, SessionSlots::CODE_STATE) << "\n\n";
+            }
         }
     }
     if (!found) std::cout << "No active sessions.\n";
+    std::cout << "[SM Log] Detached sessions: " << m_detached.size() << "\n";
+    std::cout << "[SM Log] Interned identities: " << Interner::global().size() << " ("
+        << Interner::global().reservedBytes() << " bytes)\n";
+    std::cout << "[SM Log] Storage: " << m_pool.reservedBytes() << " bytes in session slabs, "
+        << m_slots.reservedBytes() << " bytes in slot arrays\n";
 }
 
 void SessionManager::logout(const int id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end()) {
-        it->second->ac_data->secret_pairs.clear();
-        it->second->ac_data->isLogged = false;
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        m_setIdentity(*it->second, NO_ID);
+        m_setCodeState(it->second, false);
+        if (AC_Data *ac_data = it->second->ac_data.get()) {
+            ac_data->app_filter.clear();
+            m_storePairings(*ac_data, nullptr);
+            ac_data->resume_token.clear();
+        }
+        m_slots.setFlag(id, SessionSlots::LOGGED, false);
+        m_publish(*it->second);
     }
 }
 
 void SessionManager::setIsLogged(const int id, const bool isLogged) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (auto it = m_sessions.find(id); it != m_sessions.end()) {
-        it->second->ac_data->isLogged = isLogged;
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        m_slots.setFlag(id, SessionSlots::LOGGED, isLogged);
+        m_publish(*it->second);
         std::cout << "[SM Log] isLogged set to: " << isLogged
             << " for Session " << id << "\n";
     }
 }
 
 void SessionManager::setIsInCodeState(const int id, const bool isInCodeState) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (auto it = m_sessions.find(id); it != m_sessions.end()) {
-        it->second->ac_data->isInCodeState = isInCodeState;
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        m_setCodeState(it->second, isInCodeState);
+        m_publish(*it->second);
         std::cout << "[SM Log] isInCodeState set to: " << isInCodeState
             << " for Session " << id << "\n";
     }
 }
 
+size_t SessionManager::setCodeFilter(const int id, const std::vector<std::string> &app_ids) {
+    // lookup only, an app nobody paired yet can't be in anyone's pairings
+    std::vector<InternID> filter;
+    for (const std::string &app_id : app_ids)
+        if (const InternID app = Interner::global().find(app_id); app != NO_ID) filter.push_back(app);
+    std::ranges::sort(filter);
+    filter.erase(std::ranges::unique(filter).begin(), filter.end());
+    if (filter.empty() && !app_ids.empty()) filter.push_back(NO_ID); // nothing known matches, show nothing
+
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.sessions.find(id);
+    if (it == shard.sessions.end()) return 0;
+    AC_Data &ac_data = m_acData(*it->second);
+    ac_data.app_filter = std::move(filter);
+    m_storePairings(ac_data, ac_data.pairings.load());
+    const PairingsPtr shown = ac_data.code_pairings.load();
+    std::cout << "[SM Log] Code filter of Session " << id << " set to " << app_ids.size() << " apps\n";
+    return shown ? shown->entries().size() : 0;
+}
+
 void SessionManager::setIdentity(const int id, const std::string &identity) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (auto it = m_sessions.find(id); it != m_sessions.end()) {
-        it->second->identity = identity;
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        m_setIdentity(*it->second, Interner::global().intern(identity));
+        m_publish(*it->second);
         std::cout << "[SM Log] Username set to: " << identity
             << " for Session " << id << "\n";
     }
 }
 
-void SessionManager::setSecretPairings(const int id, const std::map<std::string, std::string> &pairings) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end()) {
-        it->second->ac_data->secret_pairs = pairings;
+void SessionManager::completeLogin(const int id, const std::string &identity, PairingsPtr pairings) {
+    const InternID identity_id = Interner::global().intern(identity);
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end()) {
+        m_setIdentity(*it->second, identity_id);
+        m_registerPairings(identity_id, pairings);
+        if (pairings || it->second->ac_data)
+            m_storePairings(m_acData(*it->second), std::move(pairings));
+        m_slots.setFlag(id, SessionSlots::LOGGED, true);
+        m_publish(*it->second);
+        std::cout << "[SM Log] Session " << id << " logged in as: " << identity << "\n";
     }
 }
 
-int SessionManager::getIDFromUsername(const std::string &username) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    for (auto &[id, session]: m_sessions) {
-        if (session->identity == username) return id;
+void SessionManager::setSecretPairings(const int id, const std::map<std::string, PairingSecret> &pairings) {
+    InternID identity = NO_ID;
+    {
+        Shard &shard = m_shard(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) return;
+        identity = it->second->identity;
+        if (identity == NO_ID) {
+            m_storePairings(m_acData(*it->second), Pairings::fromMap(pairings));
+            return;
+        }
+    }
+    m_setUserPairings(identity, Pairings::fromMap(pairings));
+}
+
+void SessionManager::addSecretPairing(const int id, const std::string &app_id, const PairingSecret &secret) {
+    InternID identity = NO_ID;
+    PairingsPtr current;
+    {
+        Shard &shard = m_shard(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) return;
+        identity = it->second->identity;
+        current = m_acData(*it->second).pairings.load();
+        if (identity == NO_ID) {
+            const InternID app = Interner::global().intern(app_id);
+            m_storePairings(m_acData(*it->second), current ? current->with(app, secret) : Pairings::create({{app, secret}}));
+            return;
+        }
     }
+    // another device of the user may hold a newer snapshot than this session
+    if (const PairingsPtr shared = m_userPairings(identity)) current = shared;
+    const InternID app = Interner::global().intern(app_id);
+    m_setUserPairings(identity, current ? current->with(app, secret) : Pairings::create({{app, secret}}));
+}
+
+void SessionManager::setResumeToken(const int id, const std::string &token) {
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end())
+        m_acData(*it->second).resume_token = token;
+}
+
+bool SessionManager::resumeSession(const int id, const std::string &identity, const std::string &token) {
+    const InternID identity_id = Interner::global().find(identity);
+    if (identity_id == NO_ID) return false;
+    std::optional<DetachedSession> detached = m_detached.take(token, identity_id);
+    if (!detached.has_value()) return false;
+
+    Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.sessions.find(id);
+    if (it == shard.sessions.end()) return false;
+    m_setIdentity(*it->second, identity_id);
+    AC_Data &ac_data = m_acData(*it->second);
+    m_registerPairings(identity_id, detached->pairings);
+    m_storePairings(ac_data, std::move(detached->pairings));
+    m_slots.setFlag(id, SessionSlots::LOGGED, true);
+    m_publish(*it->second);
+    std::cout << "[SM Log] Session " << id << " resumed for: " << identity << "\n";
+    return true;
+}
+
+size_t SessionManager::expireDetached() {
+    return m_detached.expire();
+}
+
+int SessionManager::getIDFromUsername(const std::string &username) const {
+    const InternID identity = Interner::global().find(username);
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    if (identity != NO_ID && identity < m_identity_index.size() && !m_identity_index[identity].empty())
+        return m_identity_index[identity].back();
     return -1;
 }
 
+std::vector<int> SessionManager::getIDsFromUsername(const std::string &username) const {
+    const InternID identity = Interner::global().find(username);
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    if (identity != NO_ID && identity < m_identity_index.size())
+        return m_identity_index[identity];
+    return {};
+}
+
 std::shared_ptr<Session> SessionManager::getSession(const int id) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end())
+    const Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const auto it = shard.sessions.find(id); it != shard.sessions.end())
         return it->second;
     return nullptr;
 }
 
+// the slot arrays are reset on add and remove, so these need no lock
 EntityType SessionManager::getEntityType(const int id) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end())
-        return it->second->type;
-    return EntityType::NOT_ASSIGNED;
+    return m_slots.getType(id);
 }
 
 bool SessionManager::getIsLogged(const int id) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end())
-        return it->second->ac_data->isLogged;
-    return false;
+    return m_slots.getFlag(id, SessionSlots::LOGGED);
+}
+
+bool SessionManager::getIsInCodeState(const int id) const {
+    return m_slots.getFlag(id, SessionSlots::CODE_STATE);
 }
 
 std::string SessionManager::getIdentity(const int id) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (const auto it = m_sessions.find(id); it != m_sessions.end())
-        return it->second->identity;
+    if (const auto snapshot = getSnapshot(id)) return snapshot->identity;
     return "";
 }
 
-std::vector<std::shared_ptr<Session>> SessionManager::getActiveSessions() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    std::vector<std::shared_ptr<Session>> sessions;
-
-    for (const auto &session: m_sessions | std::views::values) {
-        if (session->ac_data->isInCodeState) sessions.push_back(session);
+// lock free: copies the published view inside an epoch read section
+std::optional<SessionSnapshot> SessionManager::getSnapshot(const int id) const {
+    if (const EpochReaders::ReadGuard guard; guard.active()) {
+        if (const SessionSnapshot *view = m_slots.loadView(id)) return *view;
+        return std::nullopt;
     }
-    return sessions;
+    // out of reader slots, the shard lock keeps the current view alive as well
+    const Shard &shard = m_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (const SessionSnapshot *view = m_slots.loadView(id)) return *view;
+    return std::nullopt;
+}
+
+PairingsPtr SessionManager::getPairings(const std::string &identity) const {
+    return m_userPairings(Interner::global().find(identity));
+}
+
+PairingsPtr SessionManager::m_userPairings(const InternID identity) const {
+    std::lock_guard<std::mutex> lock(m_pairings_mutex);
+    if (identity == NO_ID || identity >= m_user_pairings.size()) return nullptr;
+    return m_user_pairings[identity].lock();
+}
+
+bool SessionManager::refreshCodeSubscribers(std::vector<std::shared_ptr<Session>> &subscribers,
+                                            uint64_t &version) const {
+    std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+    if (version == m_subscribers_version) return false;
+    subscribers = m_code_subscribers;
+    version = m_subscribers_version;
+    return true;
 }
@@ -2,15 +2,24 @@
 #define MY2FA_SESSIONMANAGER_HPP
 
 #pragma once
+#include <array>
 #include <atomic>
+#include <cstdint>
+#include <ctime>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Command_Layer/Base/EntityType.hpp"
+#include "EpochReclaimer.hpp"
+#include "Interner.hpp"
+#include "Pairings.hpp"
+#include "ResumptionCache.hpp"
+#include "SessionStorage.hpp"
 
 inline std::string stringifyEntityType(const EntityType &type) {
     switch (type) {
@@ -27,23 +36,43 @@ inline std::string stringifyEntityType(const EntityType &type) {
     }
 }
 
+// pre-serialized CODE_RESP frame, rebuilt only when the paired apps change
+// each window only the time field and the fixed width code slots are overwritten
+struct CodeFrame {
+    std::string data;
+    size_t time_offset = 0;
+    std::vector<size_t> code_offsets; // same order as the pairings
+    size_t step_offset = 0;
+    uint64_t pairs_version = 0; // Pairings::version() the frame was built from
+    uint64_t sent_step = 0; // newest window pushed to the session
+    std::vector<uint16_t> periods; // distinct TOTP periods of the pairings, the frame expires at the first boundary
+    time_t expires = 0; // when the codes of the newest frame sent stop being valid
+};
+
+// cold, AuthClient only data, allocated the first time a session needs it
 struct AC_Data {
-    std::atomic<bool> isLogged = false;
-    std::atomic<bool> isInCodeState = false;
-    std::map<std::string, std::string> secret_pairs;
+    std::atomic<PairingsPtr> pairings; // shared with the user's other sessions, null while logged out
+    // app_ids the code view is limited to, sorted, empty for all of them; written under the shard lock
+    std::vector<InternID> app_filter;
+    std::atomic<PairingsPtr> code_pairings; // pairings narrowed to app_filter, what the pushed frames hold
+    CodeFrame code_frame;
+    size_t subscriber_slot = SIZE_MAX; // position in SessionManager's code subscriber list
+    std::string resume_token; // the session is detached under it instead of dropped on disconnect
 };
 
+// type, isLogged and isInCodeState live in SessionManager's slot arrays, indexed by id
 struct Session {
+    explicit Session(const int id) : id(id), isValid(true) {}
+
     int id;
-    EntityType type;
-    std::string identity; // username for clients and app_id for DS
     std::atomic<bool> isValid;
-    std::optional<AC_Data> ac_data;
+    InternID identity = NO_ID; // interned username for clients and app_id for DS
+    std::unique_ptr<AC_Data> ac_data;
 };
 
 class SessionManager {
 public:
-    SessionManager() = default;
+    SessionManager();
 
     void addSession(int id);
     void removeSession(int id);
@@ -54,21 +83,87 @@ public:
 
     void setIsLogged(int id, bool isLogged);
     void setSecret(int id, const std::string &secret);
-    void setSecretPairings(int id, const std::map<std::string, std::string> &pairings);
+    // both swap a new snapshot into every session of the user
+    void setSecretPairings(int id, const std::map<std::string, PairingSecret> &pairings);
+    void addSecretPairing(int id, const std::string &app_id, const PairingSecret &secret);
     void setIsInCodeState(int id, bool isInCodeState);
+    // limits the pushed codes to app_ids, an empty list shows every pairing again;
+    // returns how many pairings the code view now holds
+    size_t setCodeFilter(int id, const std::vector<std::string> &app_ids);
     void setIdentity(int id, const std::string &identity);
+    // marks the session logged in, sets its identity and pairings in one go
+    void completeLogin(int id, const std::string &identity, PairingsPtr pairings = nullptr);
+    void setResumeToken(int id, const std::string &token);
+    // reattaches a detached session to id, false if the token is unknown, expired or not identity's
+    [[nodiscard]] bool resumeSession(int id, const std::string &identity, const std::string &token);
+    // drops detached sessions past their TTL, meant to be called from the server loop
+    size_t expireDetached();
 
-    int getIDFromUsername(const std::string &username) const;
+    // O(1) through the identity index; with several sessions per user the newest one is returned
+    [[nodiscard]] int getIDFromUsername(const std::string &username) const;
+    [[nodiscard]] std::vector<int> getIDsFromUsername(const std::string &username) const;
     [[nodiscard]] std::shared_ptr<Session> getSession(int id) const;
     [[nodiscard]] std::string getSecret(int id) const;
     [[nodiscard]] EntityType getEntityType(int id) const;
-    bool getIsLogged(int id) const;
+    [[nodiscard]] bool getIsLogged(int id) const;
+    [[nodiscard]] bool getIsInCodeState(int id) const;
     [[nodiscard]] std::string getIdentity(int id) const;
-    [[nodiscard]] std::vector<std::shared_ptr<Session>> getActiveSessions() const;
+    // copies the code-view sessions into subscribers only if they changed since version
+    bool refreshCodeSubscribers(std::vector<std::shared_ptr<Session>> &subscribers, uint64_t &version) const;
+    [[nodiscard]] std::optional<SessionSnapshot> getSnapshot(int id) const;
+    // the snapshot identity's sessions currently share, null if none holds one
+    [[nodiscard]] PairingsPtr getPairings(const std::string &identity) const;
 
 private:
-    std::map<int, std::shared_ptr<Session>> m_sessions;
-    mutable std::mutex m_mutex;
+    // sessions are spread over shards by id, each one with its own lock,
+    // so commands on different connections and the TOTP thread rarely contend
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        std::unordered_map<int, std::shared_ptr<Session>> sessions;
+        mutable std::mutex mutex;
+    };
+
+    // declared first so it outlives every shared_ptr handed out from it
+    SlabPool m_pool;
+    EpochReclaimer<SessionSnapshot> m_retired_views;
+    SessionSlots m_slots;
+    std::array<Shard, SHARD_COUNT> m_shards;
+    // lock order: shard mutex first, then the cache's own
+    ResumptionCache m_detached;
+
+    // identity -> session ids, multi-valued since a user can be logged in from several devices
+    // indexed directly by InternID since the ids are dense
+    // lock order: shard mutex first, then m_index_mutex
+    std::vector<std::vector<int>> m_identity_index;
+    mutable std::mutex m_index_mutex;
+
+    // sessions with the code view open, maintained by setIsInCodeState, logout and removeSession
+    // lock order: shard mutex first, then m_subscribers_mutex
+    std::vector<std::shared_ptr<Session>> m_code_subscribers;
+    uint64_t m_subscribers_version = 1;
+    mutable std::mutex m_subscribers_mutex;
+
+    // identity -> the pairings snapshot its sessions share, weak so it goes away with the last session
+    // lock order: shard mutex first, then m_pairings_mutex
+    std::vector<std::weak_ptr<const Pairings>> m_user_pairings;
+    mutable std::mutex m_pairings_mutex;
+
+    [[nodiscard]] Shard &m_shard(int id);
+    [[nodiscard]] const Shard &m_shard(int id) const;
+    // both expect the session's shard to be locked by the caller
+    void m_setIdentity(Session &session, InternID identity);
+    void m_indexRemove(InternID identity, int id);
+    void m_setCodeState(const std::shared_ptr<Session> &session, bool isInCodeState);
+    [[nodiscard]] static AC_Data &m_acData(Session &session);
+    // sets pairings and the filtered code_pairings derived from them, the caller holds the shard lock
+    static void m_storePairings(AC_Data &ac_data, PairingsPtr pairings);
+    void m_registerPairings(InternID identity, const PairingsPtr &pairings);
+    [[nodiscard]] PairingsPtr m_userPairings(InternID identity) const;
+    // swaps pairings into every session of identity, called without any shard lock held
+    void m_setUserPairings(InternID identity, const PairingsPtr &pairings);
+    // publishes a fresh read-only view of the session, the caller holds the shard lock
+    void m_publish(const Session &session);
 };
 
 #endif // MY2FA_SESSIONMANAGER_HPP
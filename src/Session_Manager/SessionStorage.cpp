@@ -0,0 +1,121 @@
+#include "SessionStorage.hpp"
+#include <algorithm>
+
+SlabPool::SlabPool(const size_t block_size, const size_t blocks_per_slab)
+    // every block has to be able to hold the free list link and stay max aligned
+    : m_block_size((std::max(block_size, sizeof(FreeBlock)) + alignof(std::max_align_t) - 1)
+                   / alignof(std::max_align_t) * alignof(std::max_align_t)),
+      m_blocks_per_slab(blocks_per_slab) {}
+
+SlabPool::~SlabPool() {
+    for (std::byte *slab: m_slabs)
+        ::operator delete(slab);
+}
+
+void *SlabPool::allocate() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free) {
+        auto *slab = static_cast<std::byte *>(::operator new(m_block_size * m_blocks_per_slab));
+        m_slabs.push_back(slab);
+        for (size_t i = m_blocks_per_slab; i-- > 0;) {
+            auto *block = reinterpret_cast<FreeBlock *>(slab + i * m_block_size);
+            block->next = m_free;
+            m_free = block;
+        }
+    }
+    FreeBlock *block = m_free;
+    m_free = block->next;
+    return block;
+}
+
+void SlabPool::deallocate(void *ptr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto *block = static_cast<FreeBlock *>(ptr);
+    block->next = m_free;
+    m_free = block;
+}
+
+size_t SlabPool::reservedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_slabs.size() * m_blocks_per_slab * m_block_size;
+}
+
+SessionSlots::~SessionSlots() {
+    for (auto &chunk: m_chunks) {
+        const Chunk *ptr = chunk.load();
+        if (!ptr) continue;
+        for (const auto &view: ptr->views)
+            delete view.load();
+        delete ptr;
+    }
+}
+
+SessionSlots::Chunk *SessionSlots::m_find(const int id) const {
+    if (!fits(id)) return nullptr;
+    return m_chunks[id / CHUNK_SIZE].load(std::memory_order_acquire);
+}
+
+SessionSlots::Chunk &SessionSlots::m_get(const int id) {
+    if (Chunk *chunk = m_find(id)) return *chunk;
+    std::lock_guard<std::mutex> lock(m_grow_mutex);
+    auto &slot = m_chunks[id / CHUNK_SIZE];
+    if (Chunk *chunk = slot.load(std::memory_order_acquire)) return *chunk;
+
+    auto *chunk = new Chunk;
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+        chunk->types[i].store(EntityType::NOT_ASSIGNED, std::memory_order_relaxed);
+        chunk->flags[i].store(0, std::memory_order_relaxed);
+        chunk->views[i].store(nullptr, std::memory_order_relaxed);
+    }
+    slot.store(chunk, std::memory_order_release);
+    return *chunk;
+}
+
+void SessionSlots::reset(const int id) {
+    if (!fits(id)) return;
+    Chunk &chunk = m_get(id);
+    chunk.types[id % CHUNK_SIZE].store(EntityType::NOT_ASSIGNED, std::memory_order_release);
+    chunk.flags[id % CHUNK_SIZE].store(0, std::memory_order_release);
+}
+
+EntityType SessionSlots::getType(const int id) const {
+    if (const Chunk *chunk = m_find(id))
+        return chunk->types[id % CHUNK_SIZE].load(std::memory_order_acquire);
+    return EntityType::NOT_ASSIGNED;
+}
+
+void SessionSlots::setType(const int id, const EntityType type) {
+    if (!fits(id)) return;
+    m_get(id).types[id % CHUNK_SIZE].store(type, std::memory_order_release);
+}
+
+bool SessionSlots::getFlag(const int id, const uint8_t flag) const {
+    if (const Chunk *chunk = m_find(id))
+        return chunk->flags[id % CHUNK_SIZE].load(std::memory_order_acquire) & flag;
+    return false;
+}
+
+void SessionSlots::setFlag(const int id, const uint8_t flag, const bool value) {
+    if (!fits(id)) return;
+    auto &flags = m_get(id).flags[id % CHUNK_SIZE];
+    if (value) flags.fetch_or(flag, std::memory_order_acq_rel);
+    else flags.fetch_and(static_cast<uint8_t>(~flag), std::memory_order_acq_rel);
+}
+
+const SessionSnapshot *SessionSlots::loadView(const int id) const {
+    if (const Chunk *chunk = m_find(id))
+        return chunk->views[id % CHUNK_SIZE].load(std::memory_order_seq_cst);
+    return nullptr;
+}
+
+const SessionSnapshot *SessionSlots::exchangeView(const int id, const SessionSnapshot *view) {
+    if (!fits(id)) return view; // never stored, so the caller frees it right away
+    return m_get(id).views[id % CHUNK_SIZE].exchange(view, std::memory_order_seq_cst);
+}
+
+size_t SessionSlots::reservedBytes() const {
+    size_t chunks = 0;
+    for (const auto &chunk: m_chunks)
+        if (chunk.load(std::memory_order_acquire)) chunks++;
+    return chunks * sizeof(Chunk);
+}
@@ -0,0 +1,134 @@
+#ifndef MY2FA_SESSIONSTORAGE_HPP
+#define MY2FA_SESSIONSTORAGE_HPP
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Command_Layer/Base/EntityType.hpp"
+
+// Immutable view of a session. A new one is published on every change, so readers
+// always see the fields of one consistent version.
+struct SessionSnapshot {
+    EntityType type;
+    std::string identity;
+    bool isLogged;
+    bool isInCodeState;
+};
+
+// Hands out fixed size blocks carved from larger slabs, freed blocks go to a free list.
+// The last reference to a session can be dropped on the TOTP thread, hence the mutex.
+class SlabPool {
+public:
+    explicit SlabPool(size_t block_size, size_t blocks_per_slab = 256);
+    ~SlabPool();
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    [[nodiscard]] void *allocate();
+    void deallocate(void *ptr);
+    [[nodiscard]] size_t blockSize() const { return m_block_size; }
+    [[nodiscard]] size_t reservedBytes() const;
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    const size_t m_block_size;
+    const size_t m_blocks_per_slab;
+    std::vector<std::byte *> m_slabs;
+    FreeBlock *m_free = nullptr;
+    mutable std::mutex m_mutex;
+};
+
+// std allocator over a SlabPool, meant for allocate_shared so the control block and the
+// session end up in the same pooled block
+template<typename T>
+class SlabAllocator {
+public:
+    using value_type = T;
+
+    explicit SlabAllocator(SlabPool &pool) noexcept : m_pool(&pool) {}
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U> &other) noexcept : m_pool(other.m_pool) {}
+
+    T *allocate(const size_t n) {
+        if (n * sizeof(T) > m_pool->blockSize() || alignof(T) > alignof(std::max_align_t))
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(m_pool->allocate());
+    }
+
+    void deallocate(T *ptr, const size_t n) noexcept {
+        if (n * sizeof(T) > m_pool->blockSize() || alignof(T) > alignof(std::max_align_t)) {
+            ::operator delete(ptr);
+            return;
+        }
+        m_pool->deallocate(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const SlabAllocator<U> &other) const noexcept { return m_pool == other.m_pool; }
+
+private:
+    template<typename U> friend class SlabAllocator;
+    SlabPool *m_pool;
+};
+
+// Hot per-connection state kept in parallel arrays indexed by connection id (the fd).
+// Chunks are allocated on first use and never moved, so reads need no lock.
+class SessionSlots {
+public:
+    static constexpr uint8_t LOGGED = 1 << 0;
+    static constexpr uint8_t CODE_STATE = 1 << 1;
+
+    SessionSlots() = default;
+    ~SessionSlots();
+
+    SessionSlots(const SessionSlots &) = delete;
+    SessionSlots &operator=(const SessionSlots &) = delete;
+
+    [[nodiscard]] static bool fits(const int id) { return id >= 0 && static_cast<size_t>(id) < CAPACITY; }
+
+    void reset(int id); // called when a connection slot is (re)used or released, views excluded
+
+    [[nodiscard]] EntityType getType(int id) const;
+    void setType(int id, EntityType type);
+
+    [[nodiscard]] bool getFlag(int id, uint8_t flag) const;
+    void setFlag(int id, uint8_t flag, bool value);
+
+    // only valid inside an EpochReaders::ReadGuard (or under the session's shard lock)
+    [[nodiscard]] const SessionSnapshot *loadView(int id) const;
+    // returns the previous view, which the caller has to retire
+    [[nodiscard]] const SessionSnapshot *exchangeView(int id, const SessionSnapshot *view);
+
+    [[nodiscard]] size_t reservedBytes() const;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 4096;
+    static constexpr size_t MAX_CHUNKS = 256; // up to ~1M connections
+    static constexpr size_t CAPACITY = CHUNK_SIZE * MAX_CHUNKS;
+
+    struct Chunk {
+        std::array<std::atomic<EntityType>, CHUNK_SIZE> types;
+        std::array<std::atomic<uint8_t>, CHUNK_SIZE> flags;
+        std::array<std::atomic<const SessionSnapshot *>, CHUNK_SIZE> views;
+    };
+
+    std::array<std::atomic<Chunk *>, MAX_CHUNKS> m_chunks{};
+    std::mutex m_grow_mutex;
+
+    [[nodiscard]] Chunk *m_find(int id) const;
+    [[nodiscard]] Chunk &m_get(int id);
+};
+
+#endif //MY2FA_SESSIONSTORAGE_HPP
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SHA1Batch.hpp"
+#include "TOTPGenerator.hpp"
+#include "Test_Layer/TestCheck.hpp"
+
+// The SIMD batch path keeps the keyed SHA-1 states of the secrets it has seen. Past its limit it
+// must drop the secrets that stopped coming, not everything, or a large active set of pairings
+// would be rekeyed on every batch.
+namespace {
+    using TestCheck::expect;
+
+    struct KeySet {
+        std::vector<TOTPKey> keys;
+        std::vector<const TOTPKey *> pointers;
+
+        explicit KeySet(const size_t count) {
+            for (size_t i = 0; i < count; ++i) keys.push_back(TOTPKey::generate(20));
+            for (const TOTPKey &key : keys) pointers.push_back(&key);
+        }
+    };
+}
+
+int main() {
+    if (SHA1Batch::lanes() <= 1) {
+        std::cout << "[Test Log] " << SHA1Batch::kernelName() << " kernel has no batch key cache, skipped\n";
+        return 0;
+    }
+
+    // both sets are over the cache limit on their own
+    constexpr size_t KEYS = 5000;
+    constexpr uint64_t STEP = 1000;
+    const KeySet a(KEYS);
+    const KeySet b(KEYS);
+    std::vector<uint32_t> codes(KEYS);
+
+    TOTPGenerator::generateCodes(a.pointers, DEFAULT_TOTP_PARAMS, STEP, codes.data());
+    expect(TOTPGenerator::batchKeyCacheSize() == KEYS, "first batch not cached");
+
+    // a goes idle while b keeps coming, its entries are the ones evicted
+    for (uint64_t i = 0; i < 150; ++i)
+        TOTPGenerator::generateCodes(b.pointers, DEFAULT_TOTP_PARAMS, STEP + i, codes.data());
+    expect(TOTPGenerator::batchKeyCacheSize() == KEYS, "idle keys not evicted");
+
+    bool all_match = true;
+    for (size_t i = 0; i < KEYS; ++i)
+        all_match &= codes[i] == TOTPGenerator::generateCode(b.keys[i], DEFAULT_TOTP_PARAMS, STEP + 149);
+    expect(all_match, "batch codes differ from single ones");
+
+    // a comes back, b was just used so it has to stay cached next to it
+    TOTPGenerator::generateCodes(a.pointers, DEFAULT_TOTP_PARAMS, STEP, codes.data());
+    expect(TOTPGenerator::batchKeyCacheSize() == 2 * KEYS, "active keys dropped with the idle ones");
+
+    all_match = true;
+    for (size_t i = 0; i < KEYS; ++i)
+        all_match &= codes[i] == TOTPGenerator::generateCode(a.keys[i], DEFAULT_TOTP_PARAMS, STEP);
+    expect(all_match, "codes of re-added keys differ from single ones");
+
+    return TestCheck::result(std::string("BatchKeyCache (") + SHA1Batch::kernelName() + ")");
+}
@@ -0,0 +1,64 @@
+#include "CodeWorkers.hpp"
+#include <algorithm>
+#include <functional>
+#include "TOTPGenerator.hpp"
+
+CodeWorkers::CodeWorkers(const size_t threads)
+    : m_parts(std::max<size_t>(threads, 1)) {
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back([this, i](std::stop_token stop_token) { m_run(stop_token, i); });
+}
+
+void CodeWorkers::compute(const PerParams<std::vector<const TOTPKey *>> &secrets,
+                          const PerParams<uint64_t> &steps, PerParams<std::vector<uint32_t>> &codes) {
+    for (Part &part : m_parts) {
+        for (auto &group : part.secrets) group.clear();
+        for (auto &group : part.slots) group.clear();
+    }
+    for (size_t group = 0; group < secrets.size(); ++group) {
+        codes[group].resize(secrets[group].size());
+        for (size_t i = 0; i < secrets[group].size(); ++i) {
+            Part &part = m_parts[TOTPKey::Hash{}(*secrets[group][i]) % m_parts.size()];
+            part.secrets[group].push_back(secrets[group][i]);
+            part.slots[group].push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_steps = &steps;
+    m_codes = &codes;
+    if (m_threads.empty()) {
+        m_computePart(m_parts.front());
+        return;
+    }
+    m_pending = m_threads.size();
+    m_generation++;
+    m_wake.notify_all();
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void CodeWorkers::m_run(std::stop_token stop_token, const size_t worker) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_wake.wait(lock, stop_token, [&] { return m_generation != seen; })) return;
+            seen = m_generation;
+        }
+        // the caller is blocked in compute() until m_pending drops to 0, so the part is ours
+        m_computePart(m_parts[worker]);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0) m_done.notify_one();
+    }
+}
+
+void CodeWorkers::m_computePart(Part &part) {
+    for (size_t group = 0; group < part.secrets.size(); ++group) {
+        const auto &secrets = part.secrets[group];
+        if (secrets.empty()) continue;
+        part.scratch.resize(secrets.size());
+        TOTPGenerator::generateCodes(secrets, TOTPParams::fromIndex(group), (*m_steps)[group], part.scratch.data());
+        // slots are disjoint between parts, so workers never write the same element
+        for (size_t i = 0; i < secrets.size(); ++i) (*m_codes)[group][part.slots[group][i]] = part.scratch[i];
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MY2FA_CODEWORKERS_HPP
+#define MY2FA_CODEWORKERS_HPP
+
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TOTPParams.hpp"
+
+// Persistent threads the TM thread hands code computation to. A secret always goes to the
+// same worker (by hash), so the thread local HMAC key caches of each worker stay warm and
+// only hold their share of the secrets.
+class CodeWorkers {
+public:
+    template<typename T>
+    using PerParams = std::array<T, TOTPParams::COUNT>; // indexed by TOTPParams::index()
+
+    // 0 threads computes everything on the calling thread
+    explicit CodeWorkers(size_t threads);
+    CodeWorkers(const CodeWorkers &) = delete;
+    CodeWorkers &operator=(const CodeWorkers &) = delete;
+
+    // codes[g][i] for secrets[g][i] at steps[g], blocks until every worker is done
+    void compute(const PerParams<std::vector<const TOTPKey *>> &secrets, const PerParams<uint64_t> &steps,
+                 PerParams<std::vector<uint32_t>> &codes);
+    [[nodiscard]] size_t size() const { return m_threads.size(); }
+
+private:
+    struct Part {
+        PerParams<std::vector<const TOTPKey *>> secrets;
+        PerParams<std::vector<uint32_t>> slots; // positions in the caller's codes
+        std::vector<uint32_t> scratch;
+    };
+
+    std::vector<Part> m_parts; // one per thread
+    const PerParams<uint64_t> *m_steps = nullptr;
+    PerParams<std::vector<uint32_t>> *m_codes = nullptr;
+    uint64_t m_generation = 0;
+    size_t m_pending = 0;
+    std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::condition_variable m_done;
+    std::vector<std::jthread> m_threads; // last, so they stop before the rest goes away
+
+    void m_run(std::stop_token stop_token, size_t worker);
+    void m_computePart(Part &part);
+};
+
+#endif //MY2FA_CODEWORKERS_HPP
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <thread>
+#include "Connection_Layer/ServerConnectionHandler.hpp"
+#include "Session_Manager/SessionManager.hpp"
+#include "TOTPGenerator.hpp"
+#include "TOTPManager.hpp"
+#include "Test_Layer/TestCheck.hpp"
+
+// A TOTP code is accepted once per pairing: replays are turned away by consumeCode, and a
+// turned away code must not teach the pairing's drift either.
+namespace {
+    using TestCheck::expect;
+
+    std::string codeAt(const PairingSecret &secret, const uint64_t step) {
+        std::string code(secret.params.digits, '0');
+        TOTPGenerator::formatCode(TOTPGenerator::generateCode(secret.secret, secret.params, step),
+                                  secret.params.digits, code.data());
+        return code;
+    }
+
+    void testReplayCache() {
+        ReplayCache replay(256);
+        expect(replay.getStats().reserved_bytes == 0, "replay tables allocated before use");
+
+        expect(replay.consume(1, 1, 100), "first code refused");
+        const size_t initial_bytes = replay.getStats().reserved_bytes;
+        expect(!replay.consume(1, 1, 100), "replayed code accepted");
+        expect(replay.consume(1, 2, 100) && replay.consume(2, 1, 100), "other pairings refused");
+        expect(replay.consume(1, 1, 101), "next step refused");
+
+        // the table grows up to the cap, then fails closed
+        bool all_accepted = true;
+        for (InternID user = 3; user <= 191; ++user) all_accepted &= replay.consume(user, 1, 100);
+        expect(all_accepted, "codes refused below the cap");
+        expect(!replay.consume(192, 1, 100), "code accepted over the cap");
+        expect(replay.getStats().reserved_bytes > 4 * initial_bytes, "table didn't grow");
+
+        // a step past the ring retags the oldest table in its place and frees the grown one,
+        // whose step left the ring; codes of the retagged step are no longer accepted
+        expect(replay.consume(1, 1, 100 + ReplayCache::STEPS + 1), "later step refused");
+        expect(replay.getStats().reserved_bytes == initial_bytes, "expired tables kept");
+        expect(!replay.consume(5, 1, 101), "code of an expired step accepted");
+
+        const ReplayCache::Stats stats = replay.getStats();
+        expect(stats.accepted == 194 && stats.replays == 2 && stats.rejected_full == 1, "wrong replay stats");
+    }
+}
+
+int main() {
+    testReplayCache();
+
+    SessionManager session_manager;
+    ServerConnectionHandler handler(0);
+    Context ctx{session_manager, nullptr, handler, nullptr, nullptr};
+    TOTPManager totp_manager(ctx);
+
+    // the codes below are picked for now - 1, now and now + 1, keep clear of a step boundary
+    while (TOTPGenerator::getRemainingSeconds() < 5) std::this_thread::sleep_for(std::chrono::seconds(1));
+    const PairingSecret secret{TOTPKey::generate(20), DEFAULT_TOTP_PARAMS};
+    const uint64_t now = TOTPGenerator::getTimeStep(secret.params);
+
+    const std::string code = codeAt(secret, now);
+    expect(totp_manager.consumeCode("alice", "app", secret, code), "valid code refused");
+    expect(!totp_manager.consumeCode("alice", "app", secret, code), "replayed code accepted");
+    expect(totp_manager.consumeCode("alice", "app", secret, codeAt(secret, now + 1)), "next code refused");
+    expect(!totp_manager.consumeCode("alice", "app", secret, "000000000"), "malformed code accepted");
+
+    // another pairing's step is taken first, a code of the same step is then a replay for it:
+    // the first one teaches its secret's drift, the rejected one must not
+    const PairingSecret first{TOTPKey::generate(20), DEFAULT_TOTP_PARAMS};
+    const PairingSecret second{TOTPKey::generate(20), DEFAULT_TOTP_PARAMS};
+    const size_t drifts = totp_manager.getVerifyStats().learned_drifts;
+    expect(totp_manager.consumeCode("bob", "app", first, codeAt(first, now - 1)), "late code refused");
+    expect(totp_manager.getVerifyStats().learned_drifts == drifts + 1, "drift of an accepted code not learned");
+    expect(!totp_manager.consumeCode("bob", "app", second, codeAt(second, now - 1)), "step used twice");
+    expect(totp_manager.getVerifyStats().learned_drifts == drifts + 1, "drift learned from a rejected code");
+
+    const ReplayCache::Stats stats = totp_manager.getReplayStats();
+    expect(stats.accepted == 3 && stats.replays == 2, "wrong replay stats");
+
+    return TestCheck::result("ConsumeCode");
+}
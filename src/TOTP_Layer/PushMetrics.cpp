@@ -0,0 +1,82 @@
+#include "PushMetrics.hpp"
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace {
+    // spans the pace window ahead of the boundary and everything up to a missed window
+    const std::vector<int64_t> LATENCY_BOUNDS_MS = {-15000, -10000, -5000, -2000, -1000, -500, -100, 0,
+        10, 50, 100, 250, 500, 1000, 2000, 5000, 10000, PushMetrics::WINDOW_MS};
+    const std::vector<int64_t> SESSION_BOUNDS = {1, 10, 100, 1000, 10000, 100000};
+    const std::vector<int64_t> CYCLE_BOUNDS_MS = {10, 50, 100, 500, 1000, 2000, 5000, 10000, 15000,
+        PushMetrics::WINDOW_MS};
+}
+
+Histogram::Histogram(std::vector<int64_t> bounds)
+    : m_bounds(std::move(bounds)), m_counts(std::make_unique<std::atomic<uint64_t>[]>(m_bounds.size() + 1)) {}
+
+void Histogram::record(const int64_t value) {
+    const size_t bucket = std::ranges::lower_bound(m_bounds, value) - m_bounds.begin();
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    // single writer, so plain stores are enough for the extremes
+    if (value < m_min.load(std::memory_order_relaxed)) m_min.store(value, std::memory_order_relaxed);
+    if (value > m_max.load(std::memory_order_relaxed)) m_max.store(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.bounds = m_bounds;
+    snapshot.counts.resize(m_bounds.size() + 1);
+    for (size_t i = 0; i < snapshot.counts.size(); ++i) {
+        snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    if (snapshot.count > 0) {
+        snapshot.min = m_min.load(std::memory_order_relaxed);
+        snapshot.max = m_max.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+int64_t Histogram::Snapshot::percentile(const double p) const {
+    if (count == 0) return 0;
+    const auto rank = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(bounds[i], max);
+    }
+    return max;
+}
+
+uint64_t Histogram::Snapshot::countAbove(const int64_t bound) const {
+    uint64_t above = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+        if (i == bounds.size() || bounds[i] > bound) above += counts[i];
+    return above;
+}
+
+std::string Histogram::Snapshot::toString(const char *unit) const {
+    std::ostringstream ss;
+    ss << "n=" << count;
+    if (count == 0) return ss.str();
+    ss << " min=" << min << unit << " avg=" << sum / static_cast<int64_t>(count) << unit
+       << " p50<=" << percentile(0.5) << unit << " p99<=" << percentile(0.99) << unit
+       << " max=" << max << unit << " |";
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0) continue;
+        if (i < bounds.size()) ss << " <=" << bounds[i] << ":" << counts[i];
+        else ss << " >" << bounds.back() << ":" << counts[i];
+    }
+    return ss.str();
+}
+
+PushMetrics::PushMetrics()
+    : enqueue_ms(LATENCY_BOUNDS_MS), flush_ms(LATENCY_BOUNDS_MS), sessions(SESSION_BOUNDS),
+      cycle_ms(CYCLE_BOUNDS_MS) {}
+
+PushMetrics::Snapshot PushMetrics::snapshot() const {
+    return {enqueue_ms.snapshot(), flush_ms.snapshot(), sessions.snapshot(), cycle_ms.snapshot()};
+}
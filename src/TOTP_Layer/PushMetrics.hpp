@@ -0,0 +1,70 @@
+#ifndef MY2FA_PUSHMETRICS_HPP
+#define MY2FA_PUSHMETRICS_HPP
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fixed bucket histogram, cheap enough to record every pushed frame.
+// One writer (the TM thread), any number of readers; counts are relaxed atomics, so a
+// snapshot taken mid-cycle can be a few records behind but never torn.
+class Histogram {
+public:
+    // bucket i counts values up to bounds[i], one extra bucket takes everything above the last
+    explicit Histogram(std::vector<int64_t> bounds);
+
+    void record(int64_t value);
+
+    struct Snapshot {
+        std::vector<int64_t> bounds;
+        std::vector<uint64_t> counts; // bounds.size() + 1 entries
+        uint64_t count = 0;
+        int64_t sum = 0;
+        int64_t min = 0;
+        int64_t max = 0;
+
+        // upper bound of the bucket holding the p-th fraction of the values, max for the last one
+        [[nodiscard]] int64_t percentile(double p) const;
+        // values above bound, counted by whole buckets, so bound should be one of the bounds
+        [[nodiscard]] uint64_t countAbove(int64_t bound) const;
+        // one line summary followed by the non-empty buckets, for the console
+        [[nodiscard]] std::string toString(const char *unit) const;
+    };
+
+    [[nodiscard]] Snapshot snapshot() const;
+
+private:
+    const std::vector<int64_t> m_bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_counts;
+    std::atomic<int64_t> m_sum = 0;
+    std::atomic<int64_t> m_min = INT64_MAX;
+    std::atomic<int64_t> m_max = INT64_MIN;
+};
+
+// What a code push costs in time, one record per frame or per push cycle.
+// Latencies are counted from the start of the window the frame is for, so frames
+// paced out ahead of the boundary are negative; past WINDOW_MS a frame missed its window.
+struct PushMetrics {
+    static constexpr int64_t WINDOW_MS = 30000;
+
+    Histogram enqueue_ms; // boundary to the frame being handed to send()
+    Histogram flush_ms; // boundary to send() returning, with the bytes in the socket buffer
+    Histogram sessions; // frames per push cycle
+    Histogram cycle_ms; // first to last frame of a push cycle
+
+    PushMetrics();
+
+    struct Snapshot {
+        Histogram::Snapshot enqueue_ms;
+        Histogram::Snapshot flush_ms;
+        Histogram::Snapshot sessions;
+        Histogram::Snapshot cycle_ms;
+    };
+
+    [[nodiscard]] Snapshot snapshot() const;
+};
+
+#endif //MY2FA_PUSHMETRICS_HPP
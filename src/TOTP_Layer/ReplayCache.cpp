@@ -0,0 +1,96 @@
+#include "ReplayCache.hpp"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+namespace {
+    // splitmix64 finalizer, the ids are dense so they need spreading over the table
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+}
+
+ReplayCache::ReplayCache(const size_t max_slots_per_step)
+    : m_max_slots(std::bit_ceil(std::max(max_slots_per_step, INITIAL_SLOTS))) {}
+
+void ReplayCache::m_reset(Table &table, const uint64_t step) {
+    for (Table &other : m_tables) {
+        if (&other != &table && other.step != UINT64_MAX && other.step + STEPS <= step) {
+            other.step = UINT64_MAX;
+            std::vector<Slot>().swap(other.slots);
+        }
+    }
+    table.step = step;
+    table.used = 0;
+    table.full = false;
+    // a busy window doesn't pin its peak size for the rest of the run
+    if (table.slots.size() != INITIAL_SLOTS) std::vector<Slot>(INITIAL_SLOTS).swap(table.slots);
+}
+
+ReplayCache::Slot *ReplayCache::m_probe(Table &table, const InternID user, const InternID app) {
+    const auto tag = static_cast<uint32_t>(table.step);
+    const size_t mask = table.slots.size() - 1;
+    for (size_t i = mix(static_cast<uint64_t>(user) << 32 | app) & mask;; i = (i + 1) & mask) {
+        Slot &slot = table.slots[i];
+        if (slot.step != tag || (slot.user == user && slot.app == app)) return &slot;
+    }
+}
+
+bool ReplayCache::m_grow(Table &table) const {
+    if (table.slots.size() >= m_max_slots) return false;
+    const auto tag = static_cast<uint32_t>(table.step);
+    std::vector<Slot> slots(table.slots.size() * 2);
+    const size_t mask = slots.size() - 1;
+    for (const Slot &slot : table.slots) {
+        if (slot.step != tag) continue;
+        size_t i = mix(static_cast<uint64_t>(slot.user) << 32 | slot.app) & mask;
+        while (slots[i].step == tag) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+    table.slots.swap(slots);
+    return true;
+}
+
+bool ReplayCache::consume(const InternID user, const InternID app, const uint64_t step) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Table &table = m_tables[step % STEPS];
+    if (table.step != step) {
+        // older than the step holding its place, no longer verifiable anyway
+        if (table.step != UINT64_MAX && table.step > step) {
+            m_stats.replays++;
+            return false;
+        }
+        m_reset(table, step);
+    }
+
+    Slot *slot = m_probe(table, user, app);
+    if (slot->step == static_cast<uint32_t>(step)) {
+        m_stats.replays++;
+        return false;
+    }
+    if (table.used >= m_maxUsed(table)) {
+        if (!m_grow(table)) {
+            // failing closed, a full table must not turn into a replay window
+            if (!table.full) std::cerr << "[TM Error] Replay cache full for step " << step << "\n";
+            table.full = true;
+            m_stats.rejected_full++;
+            return false;
+        }
+        slot = m_probe(table, user, app);
+    }
+    *slot = {static_cast<uint32_t>(step), user, app};
+    table.used++;
+    m_stats.accepted++;
+    return true;
+}
+
+ReplayCache::Stats ReplayCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    for (const Table &table : m_tables) stats.reserved_bytes += table.slots.capacity() * sizeof(Slot);
+    return stats;
+}
@@ -0,0 +1,67 @@
+#ifndef MY2FA_REPLAYCACHE_HPP
+#define MY2FA_REPLAYCACHE_HPP
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "Session_Manager/Interner.hpp"
+
+// Remembers which (pairing, time step) codes were already accepted so each is accepted once.
+// One open addressing table per step in a small ring; slots are tagged with their step, so
+// retagging a table drops the whole expired window without touching its slots.
+// Tables start small and double as codes come in, up to max_slots_per_step; a step at the cap
+// rejects further codes. A table goes back to its initial size when it is retagged and is
+// freed once its step falls out of the ring, so quiet windows hold next to nothing.
+class ReplayCache {
+public:
+    static constexpr size_t STEPS = 8; // covers the widest skew window TOTPManager allows
+    static constexpr size_t INITIAL_SLOTS = 64;
+    static constexpr size_t DEFAULT_MAX_SLOTS_PER_STEP = size_t{1} << 20;
+
+    struct Stats {
+        uint64_t accepted = 0;
+        uint64_t replays = 0;
+        uint64_t rejected_full = 0;
+        size_t reserved_bytes = 0;
+    };
+
+    // rounded up to a power of two, tables are only allocated once their step is used
+    explicit ReplayCache(size_t max_slots_per_step = DEFAULT_MAX_SLOTS_PER_STEP);
+
+    // true the first time the pairing's code of step is seen
+    [[nodiscard]] bool consume(InternID user, InternID app, uint64_t step);
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Slot {
+        uint32_t step = 0; // a slot is empty unless this matches its table's step
+        InternID user = NO_ID;
+        InternID app = NO_ID;
+    };
+
+    struct Table {
+        uint64_t step = UINT64_MAX; // UINT64_MAX while unused
+        size_t used = 0;
+        bool full = false;
+        std::vector<Slot> slots;
+    };
+
+    std::array<Table, STEPS> m_tables; // indexed by step % STEPS
+    size_t m_max_slots;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+
+    // load factor cap, keeps the probes short
+    [[nodiscard]] static size_t m_maxUsed(const Table &table) { return table.slots.size() / 4 * 3; }
+    // retags table for step and frees the tables of steps that left the ring
+    void m_reset(Table &table, uint64_t step);
+    // the slot holding (user, app) in table's step, or the empty slot where it would go
+    [[nodiscard]] static Slot *m_probe(Table &table, InternID user, InternID app);
+    // doubles the table and reinserts its live slots, false at the cap
+    bool m_grow(Table &table) const;
+};
+
+#endif //MY2FA_REPLAYCACHE_HPP
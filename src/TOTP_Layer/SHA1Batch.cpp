@@ -0,0 +1,195 @@
+#include "SHA1Batch.hpp"
+#include <algorithm>
+#include <openssl/evp.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr SHA1Batch::Digest IV = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    constexpr uint32_t K[4] = {0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6};
+    constexpr uint32_t PAD = 0x80000000;
+    // message length in bits, counting the 64 byte key block in front
+    constexpr uint32_t INNER_BITS = (64 + 8) * 8;
+    constexpr uint32_t OUTER_BITS = (64 + 20) * 8;
+
+    uint32_t rol(const uint32_t x, const int n) { return (x << n) | (x >> (32 - n)); }
+
+    void compress(SHA1Batch::Digest &state, const uint32_t (&block)[16]) {
+        uint32_t w[16];
+        std::copy_n(block, 16, w);
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int t = 0; t < 80; ++t) {
+            if (t >= 16) w[t & 15] = rol(w[(t - 3) & 15] ^ w[(t - 8) & 15] ^ w[(t - 14) & 15] ^ w[t & 15], 1);
+            uint32_t f;
+            if (t < 20) f = d ^ (b & (c ^ d));
+            else if (t < 40) f = b ^ c ^ d;
+            else if (t < 60) f = (b & c) | (d & (b | c));
+            else f = b ^ c ^ d;
+            const uint32_t tmp = rol(a, 5) + f + e + K[t / 20] + w[t & 15];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = tmp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    void hmacScalar(const SHA1Batch::HmacKey &key, const uint64_t counter, SHA1Batch::Digest &digest) {
+        const uint32_t inner_block[16] = {static_cast<uint32_t>(counter >> 32), static_cast<uint32_t>(counter),
+            PAD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, INNER_BITS};
+        SHA1Batch::Digest inner = key.inner;
+        compress(inner, inner_block);
+
+        const uint32_t outer_block[16] = {inner[0], inner[1], inner[2], inner[3], inner[4],
+            PAD, 0, 0, 0, 0, 0, 0, 0, 0, 0, OUTER_BITS};
+        digest = key.outer;
+        compress(digest, outer_block);
+    }
+
+#if defined(__x86_64__)
+    // 8 keys per pass, one per 32 bit lane; every lane hashes the same counter
+    constexpr size_t AVX2_LANES = 8;
+
+    template<int N>
+    __attribute__((target("avx2"))) __m256i rol8(const __m256i x) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N));
+    }
+
+    __attribute__((target("avx2"))) void compress8(__m256i (&state)[5], const __m256i (&block)[16]) {
+        __m256i w[16];
+        std::copy_n(block, 16, w);
+        __m256i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int t = 0; t < 80; ++t) {
+            if (t >= 16) {
+                w[t & 15] = rol8<1>(_mm256_xor_si256(_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                    _mm256_xor_si256(w[(t - 14) & 15], w[t & 15])));
+            }
+            __m256i f;
+            if (t < 20) f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            else if (t < 40 || t >= 60) f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            else f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+            const __m256i k = _mm256_set1_epi32(static_cast<int>(K[t / 20]));
+            const __m256i tmp = _mm256_add_epi32(_mm256_add_epi32(rol8<5>(a), f),
+                _mm256_add_epi32(_mm256_add_epi32(e, k), w[t & 15]));
+            e = d;
+            d = c;
+            c = rol8<30>(b);
+            b = a;
+            a = tmp;
+        }
+        state[0] = _mm256_add_epi32(state[0], a);
+        state[1] = _mm256_add_epi32(state[1], b);
+        state[2] = _mm256_add_epi32(state[2], c);
+        state[3] = _mm256_add_epi32(state[3], d);
+        state[4] = _mm256_add_epi32(state[4], e);
+    }
+
+    __attribute__((target("avx2"))) __m256i gather8(const SHA1Batch::HmacKey *const *keys,
+                                                     const SHA1Batch::Digest SHA1Batch::HmacKey::*half, const size_t word) {
+        alignas(32) uint32_t lanes[AVX2_LANES];
+        for (size_t l = 0; l < AVX2_LANES; ++l) lanes[l] = (keys[l]->*half)[word];
+        return _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes));
+    }
+
+    __attribute__((target("avx2"))) void hmac8(const SHA1Batch::HmacKey *const *keys, const uint64_t counter,
+                                                SHA1Batch::Digest *digests) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i inner[5], outer[5];
+        for (size_t j = 0; j < 5; ++j) {
+            inner[j] = gather8(keys, &SHA1Batch::HmacKey::inner, j);
+            outer[j] = gather8(keys, &SHA1Batch::HmacKey::outer, j);
+        }
+
+        __m256i block[16];
+        std::fill_n(block, 16, zero);
+        block[0] = _mm256_set1_epi32(static_cast<int>(counter >> 32));
+        block[1] = _mm256_set1_epi32(static_cast<int>(counter));
+        block[2] = _mm256_set1_epi32(static_cast<int>(PAD));
+        block[15] = _mm256_set1_epi32(static_cast<int>(INNER_BITS));
+        compress8(inner, block);
+
+        std::copy_n(inner, 5, block);
+        block[5] = _mm256_set1_epi32(static_cast<int>(PAD));
+        block[15] = _mm256_set1_epi32(static_cast<int>(OUTER_BITS));
+        compress8(outer, block);
+
+        alignas(32) uint32_t lanes[AVX2_LANES];
+        for (size_t j = 0; j < 5; ++j) {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), outer[j]);
+            for (size_t l = 0; l < AVX2_LANES; ++l) digests[l][j] = lanes[l];
+        }
+    }
+
+    bool hasAvx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+#endif
+}
+
+namespace SHA1Batch {
+    HmacKey prepareKey(const std::string_view key) {
+        // keys longer than a block are hashed first, shorter ones zero padded
+        unsigned char key_block[64] = {};
+        if (key.size() > sizeof(key_block)) {
+            unsigned int length = 0;
+            EVP_Digest(key.data(), key.size(), key_block, &length, EVP_sha1(), nullptr);
+        } else std::copy(key.begin(), key.end(), key_block);
+
+        uint32_t ipad[16], opad[16];
+        for (size_t i = 0; i < 16; ++i) {
+            const uint32_t word = static_cast<uint32_t>(key_block[4 * i]) << 24
+                | static_cast<uint32_t>(key_block[4 * i + 1]) << 16
+                | static_cast<uint32_t>(key_block[4 * i + 2]) << 8
+                | static_cast<uint32_t>(key_block[4 * i + 3]);
+            ipad[i] = word ^ 0x36363636;
+            opad[i] = word ^ 0x5c5c5c5c;
+        }
+        HmacKey prepared{IV, IV};
+        compress(prepared.inner, ipad);
+        compress(prepared.outer, opad);
+        return prepared;
+    }
+
+    void hmacCounter(const HmacKey *const *keys, const size_t count, const uint64_t counter, Digest *digests) {
+        size_t done = 0;
+#if defined(__x86_64__)
+        if (hasAvx2()) {
+            for (; done + AVX2_LANES <= count; done += AVX2_LANES)
+                hmac8(keys + done, counter, digests + done);
+            // pad the tail with copies of its last key and drop the extra lanes
+            if (count - done > 1) {
+                const HmacKey *tail_keys[AVX2_LANES];
+                Digest tail[AVX2_LANES];
+                for (size_t l = 0; l < AVX2_LANES; ++l)
+                    tail_keys[l] = keys[done + std::min(l, count - done - 1)];
+                hmac8(tail_keys, counter, tail);
+                std::copy_n(tail, count - done, digests + done);
+                done = count;
+            }
+        }
+#endif
+        for (; done < count; ++done)
+            hmacScalar(*keys[done], counter, digests[done]);
+    }
+
+    size_t lanes() {
+#if defined(__x86_64__)
+        if (hasAvx2()) return AVX2_LANES;
+#endif
+        return 1;
+    }
+
+    const char *kernelName() {
+#if defined(__x86_64__)
+        if (hasAvx2()) return "avx2 x8";
+#endif
+        return "scalar";
+    }
+}
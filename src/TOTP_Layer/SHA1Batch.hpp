@@ -0,0 +1,30 @@
+#ifndef MY2FA_SHA1BATCH_HPP
+#define MY2FA_SHA1BATCH_HPP
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Multi-buffer HMAC-SHA1 for the one message shape TOTP needs: an 8 byte counter.
+// With the ipad / opad states precomputed per key, every code is exactly two single block
+// compressions, so several keys can run side by side in SIMD lanes.
+namespace SHA1Batch {
+    using Digest = std::array<uint32_t, 5>; // big endian words, as SHA-1 defines them
+
+    struct HmacKey {
+        Digest inner; // state after the K ^ ipad block
+        Digest outer; // state after the K ^ opad block
+    };
+
+    [[nodiscard]] HmacKey prepareKey(std::string_view key);
+    // HMAC-SHA1(key, big endian counter) for count keys, picks the widest kernel the CPU supports
+    void hmacCounter(const HmacKey *const *keys, size_t count, uint64_t counter, Digest *digests);
+    // keys per SIMD pass, 1 when only the scalar kernel is available
+    [[nodiscard]] size_t lanes();
+    // the kernel hmacCounter dispatches to, for logs
+    [[nodiscard]] const char *kernelName();
+}
+
+#endif //MY2FA_SHA1BATCH_HPP
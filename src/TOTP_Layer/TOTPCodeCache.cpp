@@ -0,0 +1,65 @@
+#include "TOTPCodeCache.hpp"
+#include "TOTPGenerator.hpp"
+
+TOTPCodeCache::TOTPCodeCache(const TOTPParams params)
+    : m_params(params) {}
+
+TOTPCodeCache::Window *TOTPCodeCache::m_window(const uint64_t step) {
+    Window &window = m_windows[step % CACHED_STEPS];
+    if (window.step == step) return &window;
+    if (window.step != UINT64_MAX && window.step > step) return nullptr;
+    window.codes.clear(); // keeps the buckets for the next window
+    window.step = step;
+    return &window;
+}
+
+void TOTPCodeCache::getCodes(const std::span<const TOTPKey *const> secrets, const uint64_t step,
+                             uint32_t *codes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Window *window = m_window(step);
+
+    m_missing.clear();
+    m_missing_slots.clear();
+    for (size_t i = 0; i < secrets.size(); ++i) {
+        if (window) {
+            if (const auto it = window->codes.find(*secrets[i]); it != window->codes.end()) {
+                codes[i] = it->second;
+                m_hits++;
+                continue;
+            }
+        }
+        m_missing.push_back(secrets[i]);
+        m_missing_slots.push_back(i);
+    }
+    if (m_missing.empty()) return;
+
+    m_misses += m_missing.size();
+    m_missing_codes.resize(m_missing.size());
+    TOTPGenerator::generateCodes(m_missing, m_params, step, m_missing_codes.data());
+    for (size_t i = 0; i < m_missing.size(); ++i) {
+        codes[m_missing_slots[i]] = m_missing_codes[i];
+        if (window) window->codes.emplace(*m_missing[i], m_missing_codes[i]);
+    }
+}
+
+uint32_t TOTPCodeCache::getCode(const TOTPKey &secret, const uint64_t step) {
+    uint32_t code = 0;
+    const TOTPKey *const secrets[] = {&secret};
+    getCodes(secrets, step, &code);
+    return code;
+}
+
+void TOTPCodeCache::insert(const std::span<const TOTPKey *const> secrets, const uint64_t step,
+                           const uint32_t *codes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Window *window = m_window(step);
+    if (!window) return;
+    for (size_t i = 0; i < secrets.size(); ++i) window->codes.insert_or_assign(*secrets[i], codes[i]);
+}
+
+TOTPCodeCache::Stats TOTPCodeCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t entries = 0;
+    for (const Window &window : m_windows) entries += window.codes.size();
+    return {m_hits, m_misses, entries};
+}
@@ -0,0 +1,60 @@
+#ifndef MY2FA_TOTPCODECACHE_HPP
+#define MY2FA_TOTPCODECACHE_HPP
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TOTPParams.hpp"
+
+// Codes per time step of one parameter set, each secret's computed at most once per window.
+// Shared by the push path (TOTPManager frames) and the verify path (VALIDATE_CODE_SERVER).
+// A few neighbouring steps are kept for skew tolerant verification, a step's table is
+// dropped once its ring slot is needed by a newer one.
+class TOTPCodeCache {
+public:
+    static constexpr size_t CACHED_STEPS = 8;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+    };
+
+    explicit TOTPCodeCache(TOTPParams params = DEFAULT_TOTP_PARAMS);
+    TOTPCodeCache(const TOTPCodeCache &) = delete;
+    TOTPCodeCache &operator=(const TOTPCodeCache &) = delete;
+
+    [[nodiscard]] const TOTPParams &params() const { return m_params; }
+    // steps are counted in params().period; misses are computed together through the batch kernel
+    void getCodes(std::span<const TOTPKey *const> secrets, uint64_t step, uint32_t *codes);
+    [[nodiscard]] uint32_t getCode(const TOTPKey &secret, uint64_t step);
+    // stores codes computed elsewhere, e.g. ahead of the boundary on the precompute workers
+    void insert(std::span<const TOTPKey *const> secrets, uint64_t step, const uint32_t *codes);
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Window {
+        uint64_t step = UINT64_MAX; // UINT64_MAX while unused
+        std::unordered_map<TOTPKey, uint32_t, TOTPKey::Hash> codes;
+    };
+
+    const TOTPParams m_params;
+    std::array<Window, CACHED_STEPS> m_windows; // indexed by step % CACHED_STEPS
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    // scratch for the misses of one call, kept to reuse the allocations
+    std::vector<const TOTPKey *> m_missing;
+    std::vector<size_t> m_missing_slots;
+    std::vector<uint32_t> m_missing_codes;
+    mutable std::mutex m_mutex;
+
+    // null for a step older than its slot's, whose codes are computed but not cached
+    [[nodiscard]] Window *m_window(uint64_t step);
+};
+
+#endif //MY2FA_TOTPCODECACHE_HPP
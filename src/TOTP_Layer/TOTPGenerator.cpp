@@ -1,49 +1,311 @@
 #include "TOTPGenerator.hpp"
+#include <algorithm>
+#include <array>
 #include <ctime>
 #include <endian.h>
-#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
 #include <openssl/evp.h>
-#include <openssl/hmac.h>
-#include <sstream>
+#include <openssl/params.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "SHA1Batch.hpp"
+
+namespace {
+    constexpr size_t KEY_CACHE_LIMIT = 4096;
+
+    constexpr uint32_t pow10(const unsigned n) { return n == 0 ? 1 : 10 * pow10(n - 1); }
+
+    struct MacDeleter {
+        void operator()(EVP_MAC *mac) const { EVP_MAC_free(mac); }
+    };
+
+    struct MacCtxDeleter {
+        void operator()(EVP_MAC_CTX *ctx) const { EVP_MAC_CTX_free(ctx); }
+    };
+
+    // Keyed HMAC contexts of one digest, one set per thread so no locking is needed.
+    // Setting the key hashes the ipad / opad blocks once; EVP_MAC_init without a key
+    // later restarts from those saved inner and outer states instead of redoing the setup.
+    // Entries remember the start of the last step they computed; past KEY_CACHE_LIMIT the ones
+    // idle for IDLE_SECONDS are dropped, like the batch cache below, so a large active set of
+    // pairings isn't rekeyed on every push round.
+    struct KeyCache {
+        // two of the longest period, a pairing in a code view is used at least once a period
+        static constexpr uint64_t IDLE_SECONDS = 2 * std::ranges::max(TOTPParams::PERIODS);
+
+        struct Entry {
+            std::unique_ptr<EVP_MAC_CTX, MacCtxDeleter> ctx;
+            uint64_t last_used;
+        };
+
+        const char *digest;
+        std::unique_ptr<EVP_MAC, MacDeleter> mac{EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr)};
+        std::unordered_map<TOTPKey, Entry, TOTPKey::Hash> contexts{};
+        uint64_t last_sweep = 0;
+
+        // time is the start of the step being computed, so the clock costs nothing
+        EVP_MAC_CTX *get(const TOTPKey &secret, const uint64_t time) {
+            if (const auto it = contexts.find(secret); it != contexts.end()) {
+                it->second.last_used = std::max(it->second.last_used, time);
+                return it->second.ctx.get();
+            }
+            if (!mac) return nullptr;
+            sweep(time);
+
+            std::unique_ptr<EVP_MAC_CTX, MacCtxDeleter> ctx(EVP_MAC_CTX_new(mac.get()));
+            const OSSL_PARAM params[] = {
+                OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char *>(digest), 0),
+                OSSL_PARAM_construct_end()
+            };
+            if (!ctx || !EVP_MAC_init(ctx.get(), reinterpret_cast<const unsigned char *>(secret.data()),
+                    secret.size(), params))
+                return nullptr;
+            return contexts.emplace(secret, Entry{std::move(ctx), time}).first->second.ctx.get();
+        }
+
+        // the returned context is used right away, so a miss can sweep before inserting
+        void sweep(const uint64_t time) {
+            if (contexts.size() < KEY_CACHE_LIMIT || time < last_sweep + IDLE_SECONDS) return;
+            last_sweep = time;
+            std::erase_if(contexts, [time](const auto &entry) { return entry.second.last_used + IDLE_SECONDS <= time; });
+        }
+    };
+
+    // indexed by TOTPAlgorithm
+    thread_local std::array<KeyCache, TOTPParams::ALGORITHMS.size()> t_keys{{{"SHA1"}, {"SHA256"}, {"SHA512"}}};
+
+    // precomputed ipad / opad states for the SHA-1 batch kernel, also per thread.
+    // Entries remember the last batch that used them; past KEY_CACHE_LIMIT the ones idle for
+    // SWEEP_INTERVAL batches are dropped, so the cache settles at the pairings in active use
+    // instead of starting over when one push round needs more keys than the limit.
+    struct BatchCache {
+        static constexpr uint64_t SWEEP_INTERVAL = 64;
+
+        struct Entry {
+            SHA1Batch::HmacKey key;
+            uint64_t last_batch;
+        };
+
+        std::unordered_map<TOTPKey, Entry, TOTPKey::Hash> keys;
+        std::vector<const SHA1Batch::HmacKey *> key_ptrs;
+        std::vector<SHA1Batch::Digest> digests;
+        uint64_t batch = 0;
+        uint64_t last_sweep = 0;
+
+        // node based map, so the pointers stay valid while the batch inserts more keys
+        const SHA1Batch::HmacKey *get(const TOTPKey &secret) {
+            auto it = keys.find(secret);
+            if (it == keys.end()) it = keys.emplace(secret, Entry{SHA1Batch::prepareKey(secret.view()), batch}).first;
+            it->second.last_batch = batch;
+            return &it->second.key;
+        }
+
+        // only between batches, a sweep in the middle would leave earlier pointers dangling
+        void sweep() {
+            if (keys.size() <= KEY_CACHE_LIMIT || batch - last_sweep < SWEEP_INTERVAL) return;
+            last_sweep = batch;
+            std::erase_if(keys, [this](const auto &entry) { return batch - entry.second.last_batch >= SWEEP_INTERVAL; });
+        }
+    };
+
+    thread_local BatchCache t_batch;
+
+    uint8_t digestByte(const SHA1Batch::Digest &digest, const size_t i) {
+        return static_cast<uint8_t>(digest[i / 4] >> (24 - 8 * (i % 4)));
+    }
+
+    // One fully specialized TOTP variant; the parameters are compile time constants so the
+    // modulo, the digest and the step size fold into the code of each instantiation.
+    template<TOTPAlgorithm Algorithm, unsigned Digits, unsigned Period>
+    struct Engine {
+        static constexpr uint32_t MODULO = pow10(Digits);
+
+        static uint64_t step(const time_t time) {
+            return static_cast<uint64_t>(time) / Period;
+        }
+
+        static uint32_t code(const TOTPKey &secret, const uint64_t step) {
+            uint64_t const bigEndianTime = htobe64(step);
+
+            unsigned char hmac[EVP_MAX_MD_SIZE];
+            size_t hmac_length = 0;
+
+            EVP_MAC_CTX *ctx = t_keys[static_cast<size_t>(Algorithm)].get(secret, step * Period);
+            if (!ctx || !EVP_MAC_init(ctx, nullptr, 0, nullptr)
+                    || !EVP_MAC_update(ctx, reinterpret_cast<const unsigned char *>(&bigEndianTime), sizeof(bigEndianTime))
+                    || !EVP_MAC_final(ctx, hmac, &hmac_length, sizeof(hmac))) {
+                std::cerr << "[TM Error] HMAC computation failed!\n";
+                return 0;
+            }
+
+            uint8_t const offset = hmac[hmac_length - 1] & 0xf;
+            uint32_t const binary_code = (hmac[offset] & 0x7f) << 24
+                | (hmac[offset + 1] & 0xff) << 16
+                | (hmac[offset + 2] & 0xff) << 8
+                | (hmac[offset + 3] & 0xff);
+            return binary_code % MODULO;
+        }
+
+        static void codes(const std::span<const TOTPKey *const> secrets, const uint64_t step, uint32_t *out) {
+            // without SIMD lanes OpenSSL's single buffer path is faster (and uses SHA-NI where present)
+            if constexpr (Algorithm == TOTPAlgorithm::SHA1) {
+                if (SHA1Batch::lanes() > 1) {
+                    batchSHA1(secrets, step, out);
+                    return;
+                }
+            }
+            for (size_t i = 0; i < secrets.size(); ++i) out[i] = code(*secrets[i], step);
+        }
+
+        static void batchSHA1(const std::span<const TOTPKey *const> secrets, const uint64_t step, uint32_t *out) {
+            t_batch.sweep();
+            t_batch.batch++;
+            t_batch.key_ptrs.clear();
+            for (const TOTPKey *secret : secrets)
+                t_batch.key_ptrs.push_back(t_batch.get(*secret));
+            t_batch.digests.resize(secrets.size());
+            SHA1Batch::hmacCounter(t_batch.key_ptrs.data(), secrets.size(), step, t_batch.digests.data());
+
+            for (size_t i = 0; i < secrets.size(); ++i) {
+                const SHA1Batch::Digest &digest = t_batch.digests[i];
+                uint8_t const offset = digestByte(digest, 19) & 0xf;
+                uint32_t const binary_code = (digestByte(digest, offset) & 0x7f) << 24
+                    | digestByte(digest, offset + 1) << 16
+                    | digestByte(digest, offset + 2) << 8
+                    | digestByte(digest, offset + 3);
+                out[i] = binary_code % MODULO;
+            }
+        }
+    };
+
+    using DefaultEngine = Engine<DEFAULT_TOTP_PARAMS.algorithm, DEFAULT_TOTP_PARAMS.digits, DEFAULT_TOTP_PARAMS.period>;
+
+    // runtime parameters pick their instantiation through this table, indexed by TOTPParams::index()
+    struct EngineOps {
+        uint32_t (*code)(const TOTPKey &, uint64_t);
+        void (*codes)(std::span<const TOTPKey *const>, uint64_t, uint32_t *);
+    };
+
+    template<size_t Index>
+    constexpr EngineOps engineOps() {
+        constexpr TOTPParams params = TOTPParams::fromIndex(Index);
+        using E = Engine<params.algorithm, params.digits, params.period>;
+        return {&E::code, &E::codes};
+    }
+
+    template<size_t... Index>
+    constexpr std::array<EngineOps, sizeof...(Index)> engineTable(std::index_sequence<Index...>) {
+        return {engineOps<Index>()...};
+    }
+
+    constexpr auto ENGINES = engineTable(std::make_index_sequence<TOTPParams::COUNT>{});
+
+    // unsupported parameters never make it past pairing, fall back to the defaults just in case
+    const EngineOps &engine(const TOTPParams &params) {
+        return ENGINES[params.isSupported() ? params.index() : DEFAULT_TOTP_PARAMS.index()];
+    }
+
+    time_t now(const time_t customTime) {
+        return customTime == 0 ? std::time(nullptr) : customTime;
+    }
+}
 
 namespace TOTPGenerator {
-    std::string generateTOTP(const std::string &secret, const time_t customTime) {
-        uint64_t constexpr INTERVAL = 30;
-        uint32_t constexpr MODULO = 1000000;
+    std::string generateTOTP(const TOTPKey &secret, const time_t customTime) {
+        std::string code(CODE_DIGITS, '0');
+        formatCode(generateCode(secret, customTime), code.data());
+        return code;
+    }
 
-        const uint64_t currentTimestamp = (customTime == 0) ? std::time(nullptr) : customTime;
-        const uint64_t timeStep = currentTimestamp / INTERVAL;
+    uint32_t generateCode(const TOTPKey &secret, const time_t customTime) {
+        return DefaultEngine::code(secret, DefaultEngine::step(now(customTime)));
+    }
 
-        uint64_t const bigEndianTime = htobe64(timeStep);
+    void generateTOTPBatch(const std::span<const TOTPKey *const> secrets, uint32_t *codes,
+                           const time_t customTime) {
+        DefaultEngine::codes(secrets, DefaultEngine::step(now(customTime)), codes);
+    }
 
-        unsigned char hmac[EVP_MAX_MD_SIZE];
-        unsigned int hmac_length = 0;
+    uint32_t generateCode(const TOTPKey &secret, const TOTPParams &params, const uint64_t step) {
+        return engine(params).code(secret, step);
+    }
 
-        HMAC(EVP_sha1(), secret.c_str(), static_cast<int>(secret.size()),
-             reinterpret_cast<const unsigned char *>(&bigEndianTime), sizeof(bigEndianTime), hmac, &hmac_length);
+    void generateCodes(const std::span<const TOTPKey *const> secrets, const TOTPParams &params,
+                       const uint64_t step, uint32_t *codes) {
+        engine(params).codes(secrets, step, codes);
+    }
 
-        uint8_t const offset = hmac[hmac_length - 1] & 0xf;
-        uint32_t const binary_code = (hmac[offset] & 0x7f) << 24
-            | (hmac[offset + 1] & 0xff) << 16
-            | (hmac[offset + 2] & 0xff) << 8
-            | (hmac[offset + 3] & 0xff);
-        uint32_t const code = binary_code % MODULO;
+    void formatCode(const uint32_t code, char *out) {
+        formatCode(code, CODE_DIGITS, out);
+    }
 
-        std::stringstream ss;
-        ss << std::setw(6) << std::setfill('0') << code;
-        return ss.str();
+    void formatCode(uint32_t code, const size_t digits, char *out) {
+        for (size_t i = digits; i > 0; --i) {
+            out[i - 1] = static_cast<char>('0' + code % 10);
+            code /= 10;
+        }
     }
 
     uint32_t getRemainingSeconds() {
-        return 30 - (std::time(nullptr) % 30);
+        return DEFAULT_TOTP_PARAMS.period - (std::time(nullptr) % DEFAULT_TOTP_PARAMS.period);
+    }
+
+    uint64_t getTimeStep(const time_t customTime) {
+        return DefaultEngine::step(now(customTime));
+    }
+
+    time_t stepStart(const uint64_t step) {
+        return stepStart(DEFAULT_TOTP_PARAMS, step);
+    }
+
+    uint64_t getTimeStep(const TOTPParams &params, const time_t customTime) {
+        return static_cast<uint64_t>(now(customTime)) / params.period;
+    }
+
+    time_t stepStart(const TOTPParams &params, const uint64_t step) {
+        return static_cast<time_t>(step * params.period);
     }
 
-    bool verifyCode(const std::string &secret, const std::string &code) {
-        // checks the code validity, taking into consideration a tolerance window
-        if (secret.empty()) return false;
-        if (generateTOTP(secret, std::time(nullptr)) == code) return true;
-        //std::cout << "[DEBUG] rec code: " << code << "\n       gen code: " << generateTOTP(secret, std::time(nullptr)) << "\n";
+    size_t skewOrder(int first, const int skew, int *offsets) {
+        first = std::clamp(first, -skew, skew);
+        size_t count = 0;
+        offsets[count++] = first;
+        for (int distance = 1; count < static_cast<size_t>(2 * skew + 1); ++distance) {
+            // on ties the older step goes first, late clocks are the common case
+            if (first - distance >= -skew) offsets[count++] = first - distance;
+            if (first + distance <= skew) offsets[count++] = first + distance;
+        }
+        return count;
+    }
+
+    bool codeMatches(const uint32_t expected, const std::string &code) {
+        return codeMatches(expected, CODE_DIGITS, code);
+    }
+
+    bool codeMatches(const uint32_t expected, const size_t digits, const std::string &code) {
+        if (code.size() != digits || digits > MAX_CODE_DIGITS) return false;
+        char formatted[MAX_CODE_DIGITS];
+        formatCode(expected, digits, formatted);
+        return CRYPTO_memcmp(formatted, code.data(), digits) == 0;
+    }
+
+    bool verifyCode(const TOTPKey &secret, const std::string &code, int skew) {
+        if (secret.empty() || code.size() != CODE_DIGITS) return false;
+        skew = std::clamp(skew, 0, MAX_SKEW_STEPS);
+        const uint64_t now = getTimeStep();
+        int offsets[2 * MAX_SKEW_STEPS + 1];
+        const size_t count = skewOrder(0, skew, offsets);
+        for (size_t i = 0; i < count; ++i) {
+            if (codeMatches(generateCode(secret, stepStart(now + offsets[i])), code)) return true;
+        }
         return false;
     }
+
+    size_t batchKeyCacheSize() {
+        return t_batch.keys.size();
+    }
 } // namespace TOTPGenerator
@@ -2,13 +2,52 @@
 #define MY2FA_TOTPGENERATOR_HPP
 
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <ctime>
+#include <span>
 #include <string>
+#include "TOTPParams.hpp"
 
+// The parameterless overloads are the default SHA-1 / 6 digit / 30 second variant,
+// the TOTPParams ones take steps counted in the pairing's own period.
 namespace TOTPGenerator {
-    [[nodiscard]] std::string generateTOTP(const std::string& secret, time_t customTime = 0);
+    constexpr size_t CODE_DIGITS = DEFAULT_TOTP_PARAMS.digits;
+    constexpr size_t MAX_CODE_DIGITS = 8;
+    // steps accepted on either side of the current one, covers phones a few seconds off
+    constexpr int DEFAULT_SKEW_STEPS = 1;
+    // widest window verifyCode tries, so its step offsets fit in a stack array
+    constexpr int MAX_SKEW_STEPS = 8;
+
+    [[nodiscard]] std::string generateTOTP(const TOTPKey &secret, time_t customTime = 0);
+    // same code as an integer, without building a string
+    [[nodiscard]] uint32_t generateCode(const TOTPKey &secret, time_t customTime = 0);
+    // codes for many secrets in one pass over the SIMD SHA-1 kernel, same values as generateCode
+    void generateTOTPBatch(std::span<const TOTPKey *const> secrets, uint32_t *codes, time_t customTime = 0);
+    [[nodiscard]] uint32_t generateCode(const TOTPKey &secret, const TOTPParams &params, uint64_t step);
+    // same as generateTOTPBatch for any supported parameters, through the matching specialized engine
+    void generateCodes(std::span<const TOTPKey *const> secrets, const TOTPParams &params, uint64_t step,
+                       uint32_t *codes);
+    // writes exactly CODE_DIGITS zero padded digits, no terminator
+    void formatCode(uint32_t code, char *out);
+    void formatCode(uint32_t code, size_t digits, char *out);
     [[nodiscard]] uint32_t getRemainingSeconds();
-    [[nodiscard]] bool verifyCode(const std::string &secret, const std::string &code);
+    // 30 second step a timestamp falls into, now by default
+    [[nodiscard]] uint64_t getTimeStep(time_t customTime = 0);
+    [[nodiscard]] time_t stepStart(uint64_t step);
+    [[nodiscard]] uint64_t getTimeStep(const TOTPParams &params, time_t customTime = 0);
+    [[nodiscard]] time_t stepStart(const TOTPParams &params, uint64_t step);
+    // step offsets in [-skew, skew] ordered by distance from first, returns how many were written;
+    // offsets needs room for 2 * skew + 1 entries
+    size_t skewOrder(int first, int skew, int *offsets);
+    // constant time, code has to be exactly CODE_DIGITS long
+    [[nodiscard]] bool codeMatches(uint32_t expected, const std::string &code);
+    [[nodiscard]] bool codeMatches(uint32_t expected, size_t digits, const std::string &code);
+    // accepts codes up to skew steps away from now (at most MAX_SKEW_STEPS), stops at the first matching step
+    [[nodiscard]] bool verifyCode(const TOTPKey &secret, const std::string &code,
+                                  int skew = DEFAULT_SKEW_STEPS);
+    // keyed states the calling thread's SHA-1 batch path holds, for stats and tests
+    [[nodiscard]] size_t batchKeyCacheSize();
 
 }
 
@@ -0,0 +1,70 @@
+#include "TOTPKey.hpp"
+#include <algorithm>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+namespace {
+    constexpr char BASE32[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+    int base32Value(const char c) {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a';
+        if (c >= '2' && c <= '7') return c - '2' + 26;
+        return -1;
+    }
+}
+
+TOTPKey::TOTPKey(const void *bytes, const size_t size)
+    : m_size(static_cast<uint8_t>(std::min(size, MAX_SIZE))) {
+    std::copy_n(static_cast<const uint8_t *>(bytes), m_size, m_bytes.begin());
+}
+
+TOTPKey::~TOTPKey() {
+    OPENSSL_cleanse(m_bytes.data(), m_bytes.size());
+}
+
+TOTPKey TOTPKey::generate(const size_t size) {
+    TOTPKey key;
+    key.m_size = static_cast<uint8_t>(std::min(size, MAX_SIZE));
+    if (RAND_bytes(key.m_bytes.data(), key.m_size) != 1) key.m_size = 0;
+    return key;
+}
+
+std::optional<TOTPKey> TOTPKey::fromBase32(std::string_view text) {
+    while (!text.empty() && text.back() == '=') text.remove_suffix(1);
+    if (text.size() * 5 / 8 > MAX_SIZE) return std::nullopt;
+
+    TOTPKey key;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const char c : text) {
+        const int value = base32Value(c);
+        if (value < 0) return std::nullopt;
+        buffer = buffer << 5 | static_cast<uint32_t>(value);
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            key.m_bytes[key.m_size++] = static_cast<uint8_t>(buffer >> bits);
+        }
+    }
+    OPENSSL_cleanse(&buffer, sizeof(buffer));
+    return key;
+}
+
+std::string TOTPKey::toBase32() const {
+    std::string text;
+    text.reserve((m_size * 8 + 4) / 5);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < m_size; ++i) {
+        buffer = buffer << 8 | m_bytes[i];
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            text += BASE32[(buffer >> bits) & 31];
+        }
+    }
+    if (bits > 0) text += BASE32[(buffer << (5 - bits)) & 31];
+    OPENSSL_cleanse(&buffer, sizeof(buffer));
+    return text;
+}
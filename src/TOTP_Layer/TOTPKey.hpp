@@ -0,0 +1,48 @@
+#ifndef MY2FA_TOTPKEY_HPP
+#define MY2FA_TOTPKEY_HPP
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Raw HMAC key of one pairing, decoded from its base32 text once when loaded.
+// The bytes live inline, so copies don't allocate, and are wiped when the key goes away.
+// New pairings get 20 bytes (32 for the SHA-2 ones); pairings made before keys were decoded
+// keep their old base32 text as a 32 byte key, so their codes don't change.
+class TOTPKey {
+public:
+    static constexpr size_t MAX_SIZE = 32;
+    static constexpr size_t SHA1_SIZE = 20;
+
+    TOTPKey() = default;
+    TOTPKey(const void *bytes, size_t size); // anything past MAX_SIZE is dropped
+    TOTPKey(const TOTPKey &other) = default;
+    TOTPKey &operator=(const TOTPKey &other) = default;
+    ~TOTPKey();
+
+    // random key of size bytes, from OpenSSL's CSPRNG
+    [[nodiscard]] static TOTPKey generate(size_t size = SHA1_SIZE);
+    // RFC 4648 alphabet, case insensitive, '=' padding optional; nullopt if invalid or too long
+    [[nodiscard]] static std::optional<TOTPKey> fromBase32(std::string_view text);
+    [[nodiscard]] std::string toBase32() const;
+
+    [[nodiscard]] std::string_view view() const { return {reinterpret_cast<const char *>(m_bytes.data()), m_size}; }
+    [[nodiscard]] const uint8_t *data() const { return m_bytes.data(); }
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    bool operator==(const TOTPKey &other) const { return view() == other.view(); }
+
+    struct Hash {
+        size_t operator()(const TOTPKey &key) const { return std::hash<std::string_view>{}(key.view()); }
+    };
+
+private:
+    std::array<uint8_t, MAX_SIZE> m_bytes{};
+    uint8_t m_size = 0;
+};
+
+#endif //MY2FA_TOTPKEY_HPP
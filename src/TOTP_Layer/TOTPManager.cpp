@@ -1,50 +1,132 @@
 #include "TOTPManager.hpp"
 #ifdef A_SERVER
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <ranges>
+#include "SHA1Batch.hpp"
 #include "TOTPGenerator.hpp"
 
-#include "Command_Layer/Code_Login/CodeResponseCommand.hpp"
+#include "Command_Layer/Base/CommandTypes.hpp"
 #include "Command_Layer/Context.hpp"
 #include "Connection_Layer/ServerConnectionHandler.hpp"
 #include "Session_Manager/SessionManager.hpp"
 
+namespace {
+    // the TM thread blocks on its workers at every boundary, so they only pay off with a core
+    // each to spare next to it and the select loop; 0 computes the codes on the TM thread
+    size_t workerCount(const size_t max) {
+        const size_t cores = std::thread::hardware_concurrency();
+        return cores > 2 ? std::min(cores - 2, max) : 0;
+    }
+}
+
 TOTPManager::TOTPManager(Context &ctx)
-    : m_ctx(ctx) {}
+    : m_ctx(ctx), m_workers(workerCount(MAX_WORKERS)) {
+    for (size_t i = 0; i < m_codes.size(); ++i)
+        m_codes[i] = std::make_unique<TOTPCodeCache>(TOTPParams::fromIndex(i));
+}
 
 void TOTPManager::start() {
     if (m_thread.joinable()) return; // don't start if already running
     m_thread = std::jthread([this](std::stop_token stop_token) {
         this->m_run(stop_token);
     });
-    std::cout << "[TM Log] Thread started!\n";
+    std::cout << "[TM Log] Thread started! (SHA-1 kernel: " << SHA1Batch::kernelName()
+              << ", precompute workers: " << m_workers.size() << ")\n";
 }
 
 bool TOTPManager::canReceiveCode(const std::shared_ptr<Session> &session) const {
     // checks to see if the session is dead, user not logged in, or not in showcode state
-    return session && session->isValid && session->ac_data->isLogged
-        && session->ac_data->isInCodeState && !session->ac_data->secret_pairs.empty();
+    if (!session || !session->isValid || !session->ac_data
+        || !m_ctx.session_manager.getIsLogged(session->id) || !m_ctx.session_manager.getIsInCodeState(session->id))
+        return false;
+    const PairingsPtr pairings = session->ac_data->code_pairings.load();
+    return pairings && !pairings->empty();
 }
 
 void TOTPManager::m_run(std::stop_token stop_token) {
     while (!stop_token.stop_requested()) {
-        uint32_t sleep = TOTPGenerator::getRemainingSeconds();
+        const uint64_t next = TOTPGenerator::getTimeStep() + 1;
+        const auto boundary = std::chrono::system_clock::from_time_t(TOTPGenerator::stepStart(next));
 
-        // std::cout << "[TM Log] Sleeping for " << sleep << " seconds...\n";
-        for (uint32_t i = 0; i < sleep; ++i) {
-            if (stop_token.stop_requested()) return;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-        }
-        // std::cout << "[TM Log] Sleep over!\n";
+        const auto round_start = boundary - std::chrono::seconds(m_pace_seconds.load());
 
-        if (stop_token.stop_requested()) return;
+        if (!m_sleepUntil(stop_token, round_start - PRECOMPUTE_LEAD)) return;
+        m_precompute(next);
+        if (!m_sleepUntil(stop_token, round_start)) return;
+        m_last_push = {};
+        m_cycle_frames = 0;
+        m_pushRound(stop_token, next);
+        if (!m_sleepUntil(stop_token, boundary)) return;
 
-        for (auto sessions = m_ctx.session_manager.getActiveSessions();
-            const auto &session : sessions) {
-            if (!canReceiveCode(session)) continue;
-            sendCodesToClient(session);
+        // sessions that subscribed while the round was going out, the rest already have this step
+        m_ctx.session_manager.refreshCodeSubscribers(m_subscribers, m_subscribers_version);
+        m_collect(m_round, m_subscribers, TOTPGenerator::stepStart(next));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto &pending : m_round.frames) {
+                if (pending.session->ac_data->code_frame.sent_step >= next) continue;
+                m_deliver(m_round, pending, next, true);
+            }
         }
+        if (m_last_push == std::chrono::system_clock::time_point{}) continue; // nobody to push to
+        m_metrics.sessions.record(static_cast<int64_t>(m_cycle_frames));
+        m_metrics.cycle_ms.record(
+            std::chrono::duration_cast<std::chrono::milliseconds>(m_last_push - m_first_push).count());
+
+        const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(m_last_push - boundary);
+        std::lock_guard<std::mutex> lock(m_push_stats_mutex);
+        m_push_stats.rounds++;
+        m_push_stats.last_delay = delay;
+        m_push_stats.max_delay = m_push_stats.rounds == 1 ? delay : std::max(m_push_stats.max_delay, delay);
+    }
+}
+
+void TOTPManager::m_precompute(const uint64_t step) {
+    const auto start = std::chrono::steady_clock::now();
+    m_ctx.session_manager.refreshCodeSubscribers(m_subscribers, m_subscribers_version);
+    m_gather(m_round, m_subscribers);
+
+    const time_t time = TOTPGenerator::stepStart(step);
+    CodeWorkers::PerParams<uint64_t> steps{};
+    for (size_t group = 0; group < steps.size(); ++group)
+        steps[group] = TOTPGenerator::getTimeStep(m_codes[group]->params(), time);
+    m_workers.compute(m_round.secrets, steps, m_round.codes);
+    for (size_t group = 0; group < steps.size(); ++group) {
+        if (!m_round.secrets[group].empty())
+            m_codes[group]->insert(m_round.secrets[group], steps[group], m_round.codes[group].data());
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(m_push_stats_mutex);
+    m_push_stats.last_precompute = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+}
+
+bool TOTPManager::m_sleepUntil(std::stop_token stop_token, const std::chrono::system_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_sleep.wait_until(lock, stop_token, deadline, [] { return false; });
+    return !stop_token.stop_requested();
+}
+
+void TOTPManager::m_pushRound(std::stop_token stop_token, const uint64_t step) {
+    // codes for the whole round up front, then the sends spread over what is left of the window
+    m_ctx.session_manager.refreshCodeSubscribers(m_subscribers, m_subscribers_version);
+    m_collect(m_round, m_subscribers, TOTPGenerator::stepStart(step));
+    if (m_round.frames.empty()) return;
+
+    const auto start = std::chrono::system_clock::now();
+    const auto end = std::chrono::system_clock::from_time_t(TOTPGenerator::stepStart(step));
+    const size_t slices = static_cast<size_t>(std::max<int64_t>(1, (end - start) / PACE_TICK));
+    const size_t per_slice = (m_round.frames.size() + slices - 1) / slices;
+
+    for (size_t sent = 0; sent < m_round.frames.size();) {
+        if (sent > 0 && !m_sleepUntil(stop_token, start + PACE_TICK * (sent / per_slice))) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const size_t last = std::min(sent + per_slice, m_round.frames.size()); sent < last; ++sent)
+            m_deliver(m_round, m_round.frames[sent], step, true);
     }
 }
 
@@ -53,20 +135,218 @@ void TOTPManager::sendCodesToClient(const std::shared_ptr<Session> &session) {
         std::cerr << "[TM Error] Invalid session ("<< session->id << ")!\n";
         return;
     }
+    m_sendCodes({&session, 1});
+}
+
+void TOTPManager::m_sendCodes(const std::span<const std::shared_ptr<Session>> sessions) {
+    std::lock_guard<std::mutex> lock(m_mutex); // both the TM thread and REQ_CODE_CLIENT patch frames
+    const time_t now = std::time(nullptr);
+    const uint64_t step = TOTPGenerator::getTimeStep(now);
+    m_collect(m_request_batch, sessions, now);
+    for (const auto &pending : m_request_batch.frames) m_deliver(m_request_batch, pending, step);
+}
+
+void TOTPManager::m_gather(CodeBatch &batch, const std::span<const std::shared_ptr<Session>> sessions) const {
+    batch.frames.clear();
+    batch.slots.clear();
+    for (auto &secrets : batch.secrets) secrets.clear();
+    for (const auto &session : sessions) {
+        if (!canReceiveCode(session)) continue;
+        // only the apps the client subscribed to, the rest cost neither HMACs nor frame bytes
+        PairingsPtr pairings = session->ac_data->code_pairings.load();
+        if (!pairings) continue;
+        batch.frames.push_back({session, pairings, batch.slots.size()});
+        for (const auto &[secret, params] : pairings->entries() | std::views::values) {
+            auto &group = batch.secrets[params.index()];
+            batch.slots.push_back({static_cast<uint32_t>(params.index()), static_cast<uint32_t>(group.size())});
+            group.push_back(&secret);
+        }
+    }
+}
+
+void TOTPManager::m_collect(CodeBatch &batch, const std::span<const std::shared_ptr<Session>> sessions,
+                            const time_t time) {
+    m_gather(batch, sessions);
+    for (size_t group = 0; group < batch.secrets.size(); ++group) {
+        batch.codes[group].resize(batch.secrets[group].size());
+        if (batch.secrets[group].empty()) continue;
+        TOTPCodeCache &cache = *m_codes[group];
+        cache.getCodes(batch.secrets[group], TOTPGenerator::getTimeStep(cache.params(), time), batch.codes[group].data());
+    }
+}
+
+void TOTPManager::m_deliver(const CodeBatch &batch, const PendingFrame &pending, const uint64_t step,
+                            const bool push) {
+    const auto &[session, pairings, first_code] = pending;
+    CodeFrame &frame = session->ac_data->code_frame;
+    const time_t start = TOTPGenerator::stepStart(step);
+    if (frame.data.empty() || frame.pairs_version != pairings->version())
+        m_buildFrame(frame, *pairings);
+    // a frame of 60 second pairings only changes every other push, its last one is still current
+    else if (push && frame.expires > start)
+        return;
+
+    // each code is valid until the end of its own period's step, the frame until the first of them
+    time_t expires = 0;
+    for (const uint16_t period : frame.periods) {
+        const time_t end = static_cast<time_t>((static_cast<uint64_t>(start) / period + 1) * period);
+        expires = expires == 0 ? end : std::min(expires, end);
+    }
+    // seconds left until the frame expires, more than that when pushed ahead of its step
+    const time_t remaining = std::max<time_t>(1, expires - std::time(nullptr));
+    char field[STEP_WIDTH + 1];
+    std::snprintf(field, sizeof(field), "%0*lld", static_cast<int>(TIME_WIDTH), static_cast<long long>(remaining));
+    std::memcpy(frame.data.data() + frame.time_offset, field, TIME_WIDTH);
+    std::snprintf(field, sizeof(field), "%0*llu", static_cast<int>(STEP_WIDTH), static_cast<unsigned long long>(step));
+    std::memcpy(frame.data.data() + frame.step_offset, field, STEP_WIDTH);
 
+    for (size_t i = 0; i < pairings->entries().size(); ++i) {
+        TOTPGenerator::formatCode(batch.code(first_code + i), pairings->entries()[i].second.params.digits,
+            frame.data.data() + frame.code_offsets[i]);
+    }
+    frame.sent_step = std::max(frame.sent_step, step);
+    frame.expires = std::max(frame.expires, expires);
+    const auto enqueued = std::chrono::system_clock::now();
+    m_ctx.server_handler.sendData(session->id, frame.data);
+    if (push) {
+        const auto flushed = std::chrono::system_clock::now();
+        const auto boundary = std::chrono::system_clock::from_time_t(TOTPGenerator::stepStart(step));
+        m_metrics.enqueue_ms.record(std::chrono::duration_cast<std::chrono::milliseconds>(enqueued - boundary).count());
+        m_metrics.flush_ms.record(std::chrono::duration_cast<std::chrono::milliseconds>(flushed - boundary).count());
+        if (m_cycle_frames++ == 0) m_first_push = enqueued;
+        m_last_push = flushed;
+    }
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+    m_frame_bytes.fetch_add(frame.data.size(), std::memory_order_relaxed);
+}
+
+std::optional<TOTPManager::CodeMatch> TOTPManager::verifyCode(const PairingSecret &secret, const std::string &code) {
+    const TOTPParams &params = secret.params;
+    if (secret.secret.empty() || !params.isSupported() || code.size() != params.digits) return std::nullopt;
+    const int skew = m_skew_steps.load(std::memory_order_relaxed);
+    const uint64_t now = TOTPGenerator::getTimeStep(params);
+    TOTPCodeCache &cache = m_cache(params);
+
+    int drift = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_drift_mutex);
+        if (const auto it = m_drift.find(secret.secret); it != m_drift.end()) drift = it->second;
+    }
+
+    int offsets[2 * MAX_SKEW_STEPS + 1];
+    const size_t count = TOTPGenerator::skewOrder(drift, skew, offsets);
+    size_t tried = 0;
+    bool matched = false;
+    for (; tried < count && !matched; ++tried)
+        matched = TOTPGenerator::codeMatches(cache.getCode(secret.secret, now + offsets[tried]), params.digits, code);
+
+    {
+        std::lock_guard<std::mutex> lock(m_drift_mutex);
+        m_verifications++;
+        m_steps_tried += tried;
+    }
+    if (!matched) return std::nullopt;
+    return CodeMatch{now + offsets[tried - 1], offsets[tried - 1]};
+}
+
+bool TOTPManager::consumeCode(const std::string &username, const std::string &app_id,
+                              const PairingSecret &secret, const std::string &code) {
+    const std::optional<CodeMatch> match = verifyCode(secret, code);
+    if (!match) return false;
+    // the pairing exists, so interning its names only ever grows the table by known pairings
+    auto &interner = Interner::global();
+    ReplayCache &replay = m_replay[*TOTPParams::position(TOTPParams::PERIODS, secret.params.period)];
+    if (!replay.consume(interner.intern(username), interner.intern(app_id), match->step)) {
+        std::cout << "[TM Log] Rejected reused code of " << username << " for " << app_id << "\n";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_drift_mutex);
+    const auto it = m_drift.find(secret.secret);
+    if (it != m_drift.end() ? it->second != match->offset : match->offset != 0) {
+        if (m_drift.size() >= DRIFT_LIMIT) m_drift.clear();
+        m_drift.insert_or_assign(secret.secret, static_cast<int8_t>(match->offset));
+    }
+    return true;
+}
+
+void TOTPManager::setSkewSteps(const int steps) {
+    m_skew_steps = std::clamp(steps, 0, MAX_SKEW_STEPS);
+    std::cout << "[TM Log] Accepting codes up to " << m_skew_steps << " steps away\n";
+}
+
+TOTPCodeCache::Stats TOTPManager::getCodeCacheStats() const {
+    TOTPCodeCache::Stats total;
+    for (const auto &cache : m_codes) {
+        const auto stats = cache->getStats();
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.entries += stats.entries;
+    }
+    return total;
+}
+
+void TOTPManager::setPaceSeconds(const int seconds) {
+    m_pace_seconds = std::clamp(seconds, 0, MAX_PACE_SECONDS);
+    std::cout << "[TM Log] Pushing codes over the last " << m_pace_seconds << " seconds of each window\n";
+}
+
+TOTPManager::VerifyStats TOTPManager::getVerifyStats() const {
+    std::lock_guard<std::mutex> lock(m_drift_mutex);
+    return {m_verifications, m_steps_tried, m_drift.size()};
+}
+
+TOTPManager::PushStats TOTPManager::getPushStats() const {
+    std::lock_guard<std::mutex> lock(m_push_stats_mutex);
+    PushStats stats = m_push_stats;
+    stats.workers = m_workers.size();
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.frame_bytes = m_frame_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+ReplayCache::Stats TOTPManager::getReplayStats() const {
+    ReplayCache::Stats total;
+    for (const ReplayCache &replay : m_replay) {
+        const auto stats = replay.getStats();
+        total.accepted += stats.accepted;
+        total.replays += stats.replays;
+        total.rejected_full += stats.rejected_full;
+        total.reserved_bytes += stats.reserved_bytes;
+    }
+    return total;
+}
+
+void TOTPManager::m_buildFrame(CodeFrame &frame, const Pairings &pairings) {
+    // same layout as CodeResponseCommand::serialize, with placeholders for the patched fields
     constexpr char PAIR_DELIMITER = '|';
     constexpr char CODE_DELIMITER = ':';
 
-    std::stringstream ss;
+    frame.code_offsets.clear();
+    frame.periods.clear();
+    frame.expires = 0;
+    frame.data = std::to_string(static_cast<int>(CommandType::CODE_RESP)) + DELIMITER;
+    frame.time_offset = frame.data.size();
+    frame.data.append(TIME_WIDTH, '0');
+    frame.data += DELIMITER;
+    frame.step_offset = frame.data.size();
+    frame.data.append(STEP_WIDTH, '0');
+    frame.data += DELIMITER;
+
     bool first = true;
-    for (const auto &[app_id, secret] : session->ac_data->secret_pairs) {
-        if (!first) ss << PAIR_DELIMITER;
+    for (const auto &[app_id, secret] : pairings.entries()) {
+        if (!first) frame.data += PAIR_DELIMITER;
         first = false;
-        ss << app_id << CODE_DELIMITER << TOTPGenerator::generateTOTP(secret);
+        frame.data += Interner::global().view(app_id);
+        frame.data += CODE_DELIMITER;
+        frame.code_offsets.push_back(frame.data.size());
+        frame.data.append(secret.params.digits, '0');
+        if (std::ranges::find(frame.periods, secret.params.period) == frame.periods.end())
+            frame.periods.push_back(secret.params.period);
     }
-    uint32_t timeRemaining = TOTPGenerator::getRemainingSeconds();
-    m_ctx.server_handler.sendCommand(session->id,
-            std::make_unique<CodeResponseCommand>(timeRemaining, ss.str()));
+    // without pairings the frame follows the push cadence
+    if (frame.periods.empty()) frame.periods.push_back(DEFAULT_TOTP_PARAMS.period);
+    frame.pairs_version = pairings.version();
 }
 
 #endif
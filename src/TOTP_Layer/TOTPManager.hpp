@@ -3,9 +3,23 @@
 
 #ifdef A_SERVER
 #include <Command_Layer/Context.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 #include "Session_Manager/SessionManager.hpp"
+#include "CodeWorkers.hpp"
+#include "PushMetrics.hpp"
+#include "ReplayCache.hpp"
+#include "TOTPCodeCache.hpp"
+#include "TOTPGenerator.hpp"
 
 class TOTPManager {
 public:
@@ -13,10 +27,127 @@ public:
     ~TOTPManager() = default;
     void start();
     void sendCodesToClient(const std::shared_ptr<Session> &session);
+    // seconds before the boundary the next window's pushes start, spread evenly up to it
+    static constexpr int DEFAULT_PACE_SECONDS = 5;
+    static constexpr int MAX_PACE_SECONDS = 15;
+    // largest skew whose steps all fit in the code cache around the current one
+    static constexpr int MAX_SKEW_STEPS = (TOTPCodeCache::CACHED_STEPS - 1) / 2;
+
+    struct PushStats {
+        uint64_t rounds = 0;
+        size_t workers = 0;
+        std::chrono::microseconds last_precompute{0};
+        // boundary to the last push of the round, negative when all of it went out ahead
+        std::chrono::milliseconds last_delay{0};
+        std::chrono::milliseconds max_delay{0};
+        // what the server sends for codes, the frames pushed to code views
+        uint64_t frames = 0;
+        uint64_t frame_bytes = 0;
+    };
+
+    struct VerifyStats {
+        uint64_t verifications;
+        uint64_t steps_tried;
+        size_t learned_drifts;
+    };
+
+    // where a verified code was found
+    struct CodeMatch {
+        uint64_t step;
+        int offset; // steps away from now
+    };
+
+    // checks the cached codes of up to m_skew_steps windows around now, the pairing's
+    // last seen drift first; read only, the drift is only learned by consumeCode
+    [[nodiscard]] std::optional<CodeMatch> verifyCode(const PairingSecret &secret, const std::string &code);
+    // verifyCode, then marks the code as used so the same pairing can't present it again;
+    // only an accepted code updates the pairing's drift, a rejected replay leaves it alone
+    [[nodiscard]] bool consumeCode(const std::string &username, const std::string &app_id,
+                                   const PairingSecret &secret, const std::string &code);
+    void setSkewSteps(int steps);
+    // 0 goes back to a single burst right at the boundary
+    void setPaceSeconds(int seconds);
+    [[nodiscard]] TOTPCodeCache::Stats getCodeCacheStats() const;
+    [[nodiscard]] VerifyStats getVerifyStats() const;
+    [[nodiscard]] ReplayCache::Stats getReplayStats() const;
+    [[nodiscard]] PushStats getPushStats() const;
+    [[nodiscard]] PushMetrics::Snapshot getPushMetrics() const { return m_metrics.snapshot(); }
 private:
+    static constexpr size_t DRIFT_LIMIT = 65536; // learned drifts kept before starting over
+    static constexpr size_t TIME_WIDTH = 2; // zero padded, the client parses it with stoi
+    static constexpr size_t STEP_WIDTH = 12;
+    static constexpr std::chrono::milliseconds PACE_TICK{50}; // pushes of a round go out in slices this far apart
+    // how long before the push round the next step's codes are computed
+    static constexpr std::chrono::seconds PRECOMPUTE_LEAD{3};
+    static constexpr size_t MAX_WORKERS = 8;
+
     Context &m_ctx;
+    CodeWorkers m_workers; // before m_thread, which is joined first and may be waiting on them
     std::jthread m_thread;
+    std::mutex m_mutex;
+    std::mutex m_sleep_mutex;
+    std::condition_variable_any m_sleep;
+    // one cache per parameter set, indexed by TOTPParams::index()
+    std::array<std::unique_ptr<TOTPCodeCache>, TOTPParams::COUNT> m_codes;
+    // steps of different periods don't line up, so each period gets its own
+    std::array<ReplayCache, TOTPParams::PERIODS.size()> m_replay;
+    std::atomic<int> m_pace_seconds = DEFAULT_PACE_SECONDS;
+    std::atomic<int> m_skew_steps = TOTPGenerator::DEFAULT_SKEW_STEPS;
+    // offset in steps of the last accepted code, keyed by secret since each pairing has its own
+    std::unordered_map<TOTPKey, int8_t, TOTPKey::Hash> m_drift;
+    uint64_t m_verifications = 0;
+    uint64_t m_steps_tried = 0;
+    mutable std::mutex m_drift_mutex;
+    // local copy of the code subscribers, only refreshed when SessionManager reports a change
+    std::vector<std::shared_ptr<Session>> m_subscribers;
+    uint64_t m_subscribers_version = 0;
+
+    // one window's work, the secrets of every session are grouped by parameter set and each
+    // group goes through its specialized kernel together
+    struct PendingFrame {
+        std::shared_ptr<Session> session;
+        PairingsPtr pairings; // pinned so the frame and its codes come from the same snapshot
+        size_t first_code; // into CodeBatch::slots
+    };
+    struct CodeSlot {
+        uint32_t group;
+        uint32_t index;
+    };
+    struct CodeBatch {
+        std::vector<PendingFrame> frames;
+        std::vector<CodeSlot> slots; // where each pairing's code lands, in frame order
+        std::array<std::vector<const TOTPKey *>, TOTPParams::COUNT> secrets;
+        std::array<std::vector<uint32_t>, TOTPParams::COUNT> codes;
+
+        [[nodiscard]] uint32_t code(const size_t slot) const { return codes[slots[slot].group][slots[slot].index]; }
+    };
+    CodeBatch m_request_batch; // REQ_CODE_CLIENT, guarded by m_mutex
+    CodeBatch m_round; // the paced push, only touched by the TM thread
+    std::chrono::system_clock::time_point m_last_push; // of the current round, TM thread only
+    std::chrono::system_clock::time_point m_first_push; // same
+    uint64_t m_cycle_frames = 0; // same
+    PushMetrics m_metrics; // recorded by the TM thread for push cycles, REQ_CODE_CLIENT answers aren't counted
+    PushStats m_push_stats;
+    mutable std::mutex m_push_stats_mutex;
+    // bumped from the TM thread and from command handlers alike
+    std::atomic<uint64_t> m_frames = 0;
+    std::atomic<uint64_t> m_frame_bytes = 0;
+
     void m_run(std::stop_token stop_token);
+    // false if stop was requested before the deadline
+    bool m_sleepUntil(std::stop_token stop_token, std::chrono::system_clock::time_point deadline);
+    // fills the code caches for step on the workers, so the round itself only sends
+    void m_precompute(uint64_t step);
+    void m_pushRound(std::stop_token stop_token, uint64_t step);
+    void m_sendCodes(std::span<const std::shared_ptr<Session>> sessions);
+    // frames and secrets of the sessions that can receive codes, grouped by parameter set
+    void m_gather(CodeBatch &batch, std::span<const std::shared_ptr<Session>> sessions) const;
+    // m_gather plus the codes valid at time, each group's step counted in its own period
+    void m_collect(CodeBatch &batch, std::span<const std::shared_ptr<Session>> sessions, time_t time);
+    [[nodiscard]] TOTPCodeCache &m_cache(const TOTPParams &params) { return *m_codes[params.index()]; }
+    // patches and sends one frame of batch, m_mutex must be held; a push frame is timed into m_metrics
+    void m_deliver(const CodeBatch &batch, const PendingFrame &pending, uint64_t step, bool push = false);
+    static void m_buildFrame(CodeFrame &frame, const Pairings &pairings);
     [[nodiscard]] bool canReceiveCode(const std::shared_ptr<Session> &session) const;
 };
 
@@ -0,0 +1,99 @@
+#ifndef MY2FA_TOTPPARAMS_HPP
+#define MY2FA_TOTPPARAMS_HPP
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "TOTPKey.hpp"
+
+enum class TOTPAlgorithm : uint8_t {
+    SHA1,
+    SHA256,
+    SHA512,
+};
+
+// RFC 6238 parameters of one pairing, stored next to its secret in the pairs table.
+// Only the combinations below have a compiled engine; index() numbers them densely so
+// per parameter set state can live in plain arrays.
+struct TOTPParams {
+    static constexpr std::array<TOTPAlgorithm, 3> ALGORITHMS = {TOTPAlgorithm::SHA1, TOTPAlgorithm::SHA256,
+        TOTPAlgorithm::SHA512};
+    static constexpr std::array<uint8_t, 3> DIGITS = {6, 7, 8};
+    static constexpr std::array<uint16_t, 2> PERIODS = {30, 60};
+    static constexpr size_t COUNT = ALGORITHMS.size() * DIGITS.size() * PERIODS.size();
+
+    TOTPAlgorithm algorithm = TOTPAlgorithm::SHA1;
+    uint8_t digits = 6;
+    uint16_t period = 30;
+
+    bool operator==(const TOTPParams &) const = default;
+
+    [[nodiscard]] static constexpr std::optional<size_t> position(const auto &values, const auto value) {
+        for (size_t i = 0; i < values.size(); ++i)
+            if (values[i] == value) return i;
+        return std::nullopt;
+    }
+
+    [[nodiscard]] constexpr bool isSupported() const {
+        return position(ALGORITHMS, algorithm) && position(DIGITS, digits) && position(PERIODS, period);
+    }
+
+    // only meaningful for supported parameters
+    [[nodiscard]] constexpr size_t index() const {
+        return (*position(ALGORITHMS, algorithm) * DIGITS.size() + *position(DIGITS, digits)) * PERIODS.size()
+            + *position(PERIODS, period);
+    }
+
+    [[nodiscard]] static constexpr TOTPParams fromIndex(const size_t index) {
+        return {ALGORITHMS[index / PERIODS.size() / DIGITS.size()],
+            DIGITS[index / PERIODS.size() % DIGITS.size()], PERIODS[index % PERIODS.size()]};
+    }
+
+    [[nodiscard]] static constexpr std::string_view algorithmName(const TOTPAlgorithm algorithm) {
+        switch (algorithm) {
+            case TOTPAlgorithm::SHA256: return "SHA256";
+            case TOTPAlgorithm::SHA512: return "SHA512";
+            default: return "SHA1";
+        }
+    }
+
+    [[nodiscard]] static std::optional<TOTPAlgorithm> parseAlgorithm(const std::string_view name) {
+        for (const TOTPAlgorithm algorithm : ALGORITHMS)
+            if (algorithmName(algorithm) == name) return algorithm;
+        return std::nullopt;
+    }
+
+    // "SHA256/8/60", the form a DS can append to PAIR_REQ
+    [[nodiscard]] std::string toString() const {
+        return std::string(algorithmName(algorithm)) + '/' + std::to_string(digits) + '/' + std::to_string(period);
+    }
+
+    [[nodiscard]] static std::optional<TOTPParams> parse(const std::string_view text) {
+        const size_t first = text.find('/');
+        const size_t second = first == std::string_view::npos ? first : text.find('/', first + 1);
+        if (second == std::string_view::npos) return std::nullopt;
+        const auto algorithm = parseAlgorithm(text.substr(0, first));
+        if (!algorithm) return std::nullopt;
+        try {
+            const TOTPParams params{*algorithm,
+                static_cast<uint8_t>(std::stoi(std::string(text.substr(first + 1, second - first - 1)))),
+                static_cast<uint16_t>(std::stoi(std::string(text.substr(second + 1))))};
+            if (params.isSupported()) return params;
+        } catch (...) {}
+        return std::nullopt;
+    }
+};
+
+constexpr TOTPParams DEFAULT_TOTP_PARAMS{};
+
+// what the AS keeps per pairing
+struct PairingSecret {
+    TOTPKey secret;
+    TOTPParams params;
+};
+
+#endif //MY2FA_TOTPPARAMS_HPP
@@ -0,0 +1,25 @@
+#ifndef MY2FA_TESTCHECK_HPP
+#define MY2FA_TESTCHECK_HPP
+
+#pragma once
+#include <iostream>
+#include <string_view>
+
+// Checks shared by the *_Test executables: a failed expect() is reported and the test goes on,
+// result() prints the verdict and is what main returns, so ctest sees any failure.
+namespace TestCheck {
+    inline int failures = 0;
+
+    inline void expect(const bool condition, const char *what) {
+        if (condition) return;
+        std::cerr << "[Test Error] " << what << "\n";
+        failures++;
+    }
+
+    inline int result(const std::string_view name) {
+        if (failures == 0) std::cout << "[Test Log] " << name << " passed\n";
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+#endif //MY2FA_TESTCHECK_HPP